@@ -0,0 +1,310 @@
+/*
+ * app-benchmark
+ *
+ * Constructs N App sessions headlessly through Wt::Test::WTestEnvironment and
+ * renders each of them, then renders a synthetic widget tree that goes through
+ * every Theme::apply branch, and measures what building the Stylus dialog costs
+ * a session that never opens it. Prints one JSON object per line so the output
+ * of two commits can be compared directly:
+ *
+ *   ./app-benchmark --docroot ../../ --sessions 50 --widgets 2000
+ */
+
+#include "000_Server/Server.h"
+#include "001_App/App.h"
+#include "004_Theme/Theme.h"
+#include "006_Stylus/Stylus.h"
+
+#include <Wt/Test/WTestEnvironment.h>
+#include <Wt/WApplication.h>
+#include <Wt/WCheckBox.h>
+#include <Wt/WComboBox.h>
+#include <Wt/WContainerWidget.h>
+#include <Wt/WCssStyleSheet.h>
+#include <Wt/WLineEdit.h>
+#include <Wt/WMenu.h>
+#include <Wt/WPanel.h>
+#include <Wt/WProgressBar.h>
+#include <Wt/WPushButton.h>
+#include <Wt/WRadioButton.h>
+#include <Wt/WStackedWidget.h>
+#include <Wt/WTabWidget.h>
+#include <Wt/WText.h>
+#include <Wt/WTextArea.h>
+#include <Wt/WValidator.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<unsigned long> allocations{0};
+std::atomic<unsigned long> allocatedBytes{0};
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMicros(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+struct Options {
+    std::string docRoot = "../../";
+    int sessions = 20;
+    int widgets = 2000;
+};
+
+struct RenderStats {
+    double micros = 0;
+    std::size_t bytes = 0;
+    unsigned long allocations = 0;
+    Theme::Counters theme;
+};
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--docroot" && i + 1 < argc) {
+            options.docRoot = argv[++i];
+        } else if (arg == "--sessions" && i + 1 < argc) {
+            options.sessions = std::atoi(argv[++i]);
+        } else if (arg == "--widgets" && i + 1 < argc) {
+            options.widgets = std::atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.sessions > 0 && options.widgets > 0;
+}
+
+/*
+ * WTestEnvironment has no document root, so the bundles App and Theme load via
+ * docRoot() are loaded again from the given one. Templates resolve their text at
+ * render time, so this happens before anything is rendered.
+ */
+void useBundles(Wt::WApplication& app, const std::string& docRoot)
+{
+    static const char* BUNDLES[] = {
+        "/static/0_stylus/xml/000_General/General_components",
+        "/static/0_stylus/xml/000_General/Application_Shell",
+        "/static/0_stylus/xml/001_Auth/ovrwt-auth",
+        "/static/0_stylus/xml/001_Auth/ovrwt-auth-login",
+        "/static/0_stylus/xml/001_Auth/ovrwt-auth-strings",
+        "/static/0_stylus/xml/001_Auth/ovrwt-registration-view",
+        "/static/0_stylus/xml/002_Stylus/stylus_svg"
+    };
+    for (const char* bundle : BUNDLES) {
+        app.messageResourceBundle().use(docRoot + bundle);
+    }
+}
+
+// Renders the whole widget tree and inline stylesheet, the bulk of a bootstrap response
+RenderStats render(Wt::WApplication& app)
+{
+    RenderStats stats;
+    const Theme::Counters before = Theme::counters();
+    const unsigned long allocationsBefore = allocations.load(std::memory_order_relaxed);
+    const auto start = Clock::now();
+
+    std::stringstream html;
+    app.root()->htmlText(html);
+    const std::string css = app.styleSheet().cssText(true);
+
+    stats.micros = elapsedMicros(start);
+    stats.allocations = allocations.load(std::memory_order_relaxed) - allocationsBefore;
+    stats.bytes = html.str().size() + css.size();
+    stats.theme.widgetApply = Theme::counters().widgetApply - before.widgetApply;
+    stats.theme.elementApply = Theme::counters().elementApply - before.elementApply;
+    stats.theme.validationStyle = Theme::counters().validationStyle - before.validationStyle;
+    return stats;
+}
+
+void benchmarkSessions(const Options& options)
+{
+    double constructMicros = 0;
+    double renderMicros = 0;
+    std::size_t bytes = 0;
+    unsigned long constructAllocations = 0;
+    unsigned long renderAllocations = 0;
+    unsigned long themeApply = 0;
+    unsigned long validationStyle = 0;
+
+    for (int i = 0; i < options.sessions; ++i) {
+        Wt::Test::WTestEnvironment env("/", options.docRoot + "/wt_config.xml");
+
+        const unsigned long allocationsBefore = allocations.load(std::memory_order_relaxed);
+        const auto start = Clock::now();
+        App app(env);
+        constructMicros += elapsedMicros(start);
+        constructAllocations += allocations.load(std::memory_order_relaxed) - allocationsBefore;
+
+        useBundles(app, options.docRoot);
+        const RenderStats stats = render(app);
+        renderMicros += stats.micros;
+        bytes += stats.bytes;
+        renderAllocations += stats.allocations;
+        themeApply += stats.theme.widgetApply + stats.theme.elementApply;
+        validationStyle += stats.theme.validationStyle;
+    }
+
+    const double n = options.sessions;
+    std::cout << "{\"benchmark\":\"session\""
+              << ",\"sessions\":" << options.sessions
+              << ",\"construct_us\":" << constructMicros / n
+              << ",\"construct_allocations\":" << constructAllocations / n
+              << ",\"render_us\":" << renderMicros / n
+              << ",\"bootstrap_bytes\":" << bytes / n
+              << ",\"theme_apply_calls\":" << themeApply / n
+              << ",\"validation_style_calls\":" << validationStyle / n
+              << ",\"render_allocations\":" << renderAllocations / n
+              << "}" << std::endl;
+}
+
+// One widget of every kind Theme::apply distinguishes, cycled until the tree has `count` widgets
+void addSyntheticWidgets(Wt::WContainerWidget* parent, int count)
+{
+    int added = 0;
+    while (added < count) {
+        auto* group = parent->addNew<Wt::WContainerWidget>();
+        group->addNew<Wt::WPushButton>("Button");
+        auto* lineEdit = group->addNew<Wt::WLineEdit>();
+        lineEdit->setValidator(std::make_shared<Wt::WValidator>(true));
+        lineEdit->validate();
+        group->addNew<Wt::WCheckBox>("Check");
+        group->addNew<Wt::WRadioButton>("Radio");
+        group->addNew<Wt::WComboBox>()->addItem("Item");
+        group->addNew<Wt::WTextArea>();
+        group->addNew<Wt::WProgressBar>()->setValue(50);
+
+        auto* panel = group->addNew<Wt::WPanel>();
+        panel->setTitle("Panel");
+        panel->setCentralWidget(std::make_unique<Wt::WText>("Body"));
+
+        auto* tabs = group->addNew<Wt::WTabWidget>();
+        tabs->addTab(std::make_unique<Wt::WText>("First"), "First");
+        tabs->addTab(std::make_unique<Wt::WText>("Second"), "Second");
+
+        auto* stack = group->addNew<Wt::WStackedWidget>();
+        auto* menu = group->addNew<Wt::WMenu>(stack);
+        menu->addItem("One", std::make_unique<Wt::WText>("One"));
+        menu->addSeparator();
+        menu->addItem("Two", std::make_unique<Wt::WText>("Two"));
+
+        added += 12;
+    }
+}
+
+/*
+ * App only constructs Stylus on the first Alt+Q of a user with the STYLUS
+ * permission. This constructs it eagerly in each session, as App used to for
+ * every visitor, to show what the lazy construction saves.
+ */
+void benchmarkStylus(const Options& options)
+{
+    double constructMicros = 0;
+    unsigned long constructAllocations = 0;
+    unsigned long constructBytes = 0;
+    std::size_t bootstrapBytes = 0;
+
+    for (int i = 0; i < options.sessions; ++i) {
+        Wt::Test::WTestEnvironment env("/", options.docRoot + "/wt_config.xml");
+        App app(env);
+        useBundles(app, options.docRoot);
+        const std::size_t cssBefore = app.styleSheet().cssText(true).size();
+
+        const unsigned long allocationsBefore = allocations.load(std::memory_order_relaxed);
+        const unsigned long bytesBefore = allocatedBytes.load(std::memory_order_relaxed);
+        const auto start = Clock::now();
+        auto* stylus = app.root()->addChild(std::make_unique<Stylus::Stylus>(app.session()));
+        constructMicros += elapsedMicros(start);
+        constructAllocations += allocations.load(std::memory_order_relaxed) - allocationsBefore;
+        constructBytes += allocatedBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+        // The dialog is rendered with the bootstrap even while hidden
+        std::stringstream html;
+        stylus->htmlText(html);
+        bootstrapBytes += html.str().size() + app.styleSheet().cssText(true).size() - cssBefore;
+    }
+
+    const double n = options.sessions;
+    std::cout << "{\"benchmark\":\"stylus_eager\""
+              << ",\"sessions\":" << options.sessions
+              << ",\"construct_us\":" << constructMicros / n
+              << ",\"construct_allocations\":" << constructAllocations / n
+              << ",\"construct_allocated_bytes\":" << constructBytes / n
+              << ",\"bootstrap_bytes\":" << bootstrapBytes / n
+              << "}" << std::endl;
+}
+
+void benchmarkSyntheticTree(const Options& options)
+{
+    Wt::Test::WTestEnvironment env("/", options.docRoot + "/wt_config.xml");
+    Wt::WApplication app(env);
+    app.setTheme(std::make_shared<Theme>());
+    useBundles(app, options.docRoot);
+
+    addSyntheticWidgets(app.root(), options.widgets);
+
+    const RenderStats first = render(app);
+    const double applies = first.theme.elementApply ? first.theme.elementApply : 1;
+
+    std::cout << "{\"benchmark\":\"synthetic_tree\""
+              << ",\"widgets\":" << options.widgets
+              << ",\"render_us\":" << first.micros
+              << ",\"bytes\":" << first.bytes
+              << ",\"element_apply_calls\":" << first.theme.elementApply
+              << ",\"widget_apply_calls\":" << first.theme.widgetApply
+              << ",\"validation_style_calls\":" << first.theme.validationStyle
+              << ",\"allocations\":" << first.allocations
+              << ",\"ns_per_element\":" << first.micros * 1000.0 / applies
+              << "}" << std::endl;
+}
+
+}
+
+void* operator new(std::size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Usage: app-benchmark [--docroot <dir>] [--sessions <n>] [--widgets <n>]\n";
+        return 2;
+    }
+
+    Server::configureAuth();
+    // WTestEnvironment has no document root, without this Theme would not find
+    // the stylesheet chunks and link the whole bundle, unlike a deployment
+    Theme::setDocRoot(options.docRoot);
+
+    benchmarkSessions(options);
+    benchmarkStylus(options);
+    benchmarkSyntheticTree(options);
+    return 0;
+}
@@ -0,0 +1,177 @@
+#!/usr/bin/env bash
+# Script to vendor the Monaco editor distribution into static/vendor
+# Usage: ./scripts/libs/monaco/download.sh [options]
+
+set -eo pipefail  # Exit on any error, also of the first command of a pipe
+
+MONACO_SCRIPT_DIR="$(cd "$(dirname "$(readlink -f "${BASH_SOURCE[0]}")")" && pwd)"
+SCRIPTS_ROOT="$(cd "$MONACO_SCRIPT_DIR/../.." && pwd)"
+PROJECT_ROOT="$(dirname "$SCRIPTS_ROOT")"
+SCRIPT_NAME="$(basename "$0")"
+OUTPUT_DIR="$SCRIPTS_ROOT/output/libs/monaco"
+LOG_FILE="$OUTPUT_DIR/${SCRIPT_NAME%.sh}.log"
+
+mkdir -p "$OUTPUT_DIR"
+> "$LOG_FILE"
+
+# Source shared utilities
+# shellcheck disable=SC1090,SC1091
+source "$SCRIPTS_ROOT/utils.sh"
+
+show_usage() {
+    echo -e "${BOLD}${BLUE}Usage:${NC} $0 [options]"
+    echo ""
+    echo -e "${BOLD}${GREEN}Description:${NC}"
+    echo "  Downloads the Monaco editor release from the npm registry and installs its"
+    echo "  min/ build under static/vendor/monaco-editor/<version>, where the server"
+    echo "  serves it with immutable caching"
+    echo ""
+    echo -e "${BOLD}${YELLOW}Options:${NC}"
+    echo -e "  ${CYAN}-h, --help${NC}        Show this help message"
+    echo -e "  ${CYAN}--version VERSION${NC} Download specific version (default: $MONACO_VERSION)"
+    echo -e "  ${CYAN}--force${NC}           Force re-download even if already exists"
+    echo ""
+    echo -e "${BOLD}${YELLOW}Note:${NC} MONACO_VERSION in src/005_Components/MonacoEditor.cpp selects the version in use"
+}
+
+# Default values, keep in sync with MONACO_VERSION in MonacoEditor.cpp
+MONACO_VERSION="0.34.1"
+FORCE_DOWNLOAD=false
+
+if [ "$1" = "--help" ] || [ "$1" = "-h" ]; then
+    show_usage
+    exit 0
+fi
+
+print_status "Starting ${SCRIPT_NAME%.sh}..."
+
+# Argument parsing
+while [[ $# -gt 0 ]]; do
+    case $1 in
+        --version)
+            if [ -z "$2" ]; then
+                print_error "Version argument is required"
+                show_usage
+                exit 1
+            fi
+            MONACO_VERSION="$2"
+            shift 2
+            ;;
+        --force)
+            FORCE_DOWNLOAD=true
+            shift
+            ;;
+        *)
+            print_error "Unknown option: $1"
+            show_usage
+            exit 1
+            ;;
+    esac
+done
+
+TARGET_DIR="$PROJECT_ROOT/static/vendor/monaco-editor/$MONACO_VERSION"
+TARBALL_URL="https://registry.npmjs.org/monaco-editor/-/monaco-editor-$MONACO_VERSION.tgz"
+
+check_tools() {
+    for tool in curl tar; do
+        if ! command -v "$tool" &> /dev/null; then
+            print_error "$tool is not installed. Please install $tool first."
+            exit 1
+        fi
+    done
+}
+
+check_existing_monaco() {
+    if [ -f "$TARGET_DIR/min/vs/loader.js" ] && [ "$FORCE_DOWNLOAD" = false ]; then
+        print_warning "Monaco $MONACO_VERSION already exists at: $TARGET_DIR"
+        print_status "Use --force to re-download or remove the directory manually"
+        return 1
+    fi
+    return 0
+}
+
+# Downloads and unpacks the release into a scratch directory, the target is not touched
+fetch_monaco() {
+    local tmp_dir="$1"
+
+    print_status "Downloading Monaco editor $MONACO_VERSION..."
+    print_status "Tarball: $TARBALL_URL"
+    if ! curl -fsSL "$TARBALL_URL" -o "$tmp_dir/monaco.tgz" 2>&1 | tee -a "$LOG_FILE"; then
+        print_error "Failed to download $TARBALL_URL"
+        return 1
+    fi
+
+    if ! tar -xzf "$tmp_dir/monaco.tgz" -C "$tmp_dir" package/min package/LICENSE 2>&1 | tee -a "$LOG_FILE"; then
+        print_error "Failed to unpack $TARBALL_URL"
+        return 1
+    fi
+
+    if [ ! -f "$tmp_dir/package/min/vs/loader.js" ] || [ ! -f "$tmp_dir/package/min/vs/base/worker/workerMain.js" ]; then
+        print_error "The release has no Monaco loader or worker"
+        return 1
+    fi
+
+    mkdir -p "$tmp_dir/release" &&
+        mv "$tmp_dir/package/min" "$tmp_dir/release/min" &&
+        mv "$tmp_dir/package/LICENSE" "$tmp_dir/release/LICENSE"
+}
+
+download_monaco() {
+    # Next to the target, so replacing it below is a rename and not a copy
+    local parent_dir tmp_dir
+    parent_dir="$(dirname "$TARGET_DIR")"
+    mkdir -p "$parent_dir"
+    tmp_dir="$(mktemp -d "$parent_dir/.download.XXXXXX")"
+
+    if ! fetch_monaco "$tmp_dir"; then
+        rm -rf "$tmp_dir"
+        return 1
+    fi
+
+    # The directory is versioned, so the URLs change with the content: never update
+    # in place. A working copy is only removed once the new one is in its place.
+    if [ -d "$TARGET_DIR" ] && ! mv "$TARGET_DIR" "$tmp_dir/previous"; then
+        print_error "Cannot move $TARGET_DIR aside"
+        rm -rf "$tmp_dir"
+        return 1
+    fi
+    if ! mv "$tmp_dir/release" "$TARGET_DIR"; then
+        print_error "Cannot install into $TARGET_DIR"
+        if [ -d "$tmp_dir/previous" ]; then
+            mv "$tmp_dir/previous" "$TARGET_DIR"
+        fi
+        rm -rf "$tmp_dir"
+        return 1
+    fi
+    rm -rf "$tmp_dir"
+}
+
+verify_download() {
+    if [ ! -f "$TARGET_DIR/min/vs/loader.js" ] || [ ! -f "$TARGET_DIR/min/vs/base/worker/workerMain.js" ]; then
+        print_error "Monaco loader or worker not found after download"
+        return 1
+    fi
+
+    local size
+    size=$(du -sh "$TARGET_DIR" 2>/dev/null | cut -f1 || echo "unknown")
+
+    echo ""
+    print_status "Download Summary:"
+    echo -e "  ${CYAN}Version:${NC} $MONACO_VERSION"
+    echo -e "  ${CYAN}Size:${NC} $size"
+    echo -e "  ${CYAN}Location:${NC} $TARGET_DIR"
+    echo ""
+}
+
+check_tools
+
+if check_existing_monaco; then
+    download_monaco
+    verify_download
+
+    print_success "Monaco editor download completed successfully!"
+else
+    print_status "Monaco editor already available"
+fi
+
+print_success "${SCRIPT_NAME%.sh} completed successfully!"
@@ -1,11 +1,23 @@
 #define WTHTTP_CONFIGURATION "../wt_config.xml"
 
 #include "000_Server/Server.h"
+#include "000_Server/StaticFileResource.h"
+#include "000_Server/ThumbnailResource.h"
 #include "001_App/App.h"
+#include "004_Theme/TailwindIndexResource.h"
+#include "004_Theme/Theme.h"
+#include "007_State/StylusState.h"
+#include "007_State/UserPreferences.h"
+#include "009_Services/FileIndex.h"
+#include "009_Services/TailwindBuilder.h"
+#include "009_Services/TemplateHotSwap.h"
+#include "009_Services/ThumbnailService.h"
 #include <Wt/WSslInfo.h>
 #include <Wt/WLogger.h>
+#include <algorithm>
 #include <csignal>
 #include <memory>
+#include <thread>
 
 #include <Wt/Auth/AuthService.h>
 #include <Wt/Auth/HashFunction.h>
@@ -16,6 +28,25 @@
 #include <Wt/Auth/FacebookService.h>
 #include <Wt/Auth/Mfa/TotpProcess.h>
 
+namespace {
+
+// The --docroot option without the static path list wthttp allows after a ';'
+std::string docRootArgument(int argc, char **argv)
+{
+    std::string docroot = ".";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--docroot" && i + 1 < argc) {
+            docroot = argv[++i];
+        } else if (arg.rfind("--docroot=", 0) == 0) {
+            docroot = arg.substr(10);
+        }
+    }
+    return docroot.substr(0, docroot.find(';'));
+}
+
+}
+
 // Define static members
 Wt::Auth::AuthService Server::authService;
 Wt::Auth::PasswordService Server::passwordService(Server::authService);
@@ -36,6 +67,33 @@ Server::Server(int argc, char **argv)
         },
         "/");
 
+    // Vendored libraries live in versioned directories, so they are served immutable
+    addResource(std::make_shared<StaticFileResource>(docRootArgument(argc_, argv_) + "/static/vendor"), "/vendor");
+    // Stylesheet chunks, linked with a ?v= that changes with their content, see Theme
+    Theme::setDocRoot(docRootArgument(argc_, argv_));
+    addResource(std::make_shared<StaticFileResource>(docRootArgument(argc_, argv_) + "/static/css"), "/css");
+    // Large assets (media, Stylus-managed images) are streamed in chunks and seekable
+    addResource(std::make_shared<StaticFileResource>(docRootArgument(argc_, argv_) + "/static",
+                                                     StaticFileResource::Caching::Revalidate), "/assets");
+    // Class completions of the Monaco editors, see MonacoEditor
+    addResource(std::make_shared<TailwindIndexResource>(docRootArgument(argc_, argv_)), "/tailwind-index.json");
+
+    // Resized images for the Stylus images panel, generated on a few threads so a
+    // grid full of new images cannot take over the request threads
+    ThumbnailService::instance().start(docRootArgument(argc_, argv_) + "/cache/thumbnails",
+                                       std::max(1u, std::thread::hardware_concurrency() / 4));
+    addResource(std::make_shared<ThumbnailResource>(docRootArgument(argc_, argv_) + "/static"), "/thumbnails");
+
+    // Listings of the Stylus panels, scanned once here and kept current through inotify
+    FileIndex::instance().start(docRootArgument(argc_, argv_) + "/static/0_stylus");
+    // Saved bundles are pushed to every session, see TemplateHotSwap
+    TemplateHotSwap::instance().start("xml");
+    // Edits of input.css rebuild the stylesheet in the background, see TailwindBuilder
+    TailwindBuilder::instance().start(docRootArgument(argc_, argv_));
+    StylusState::instance().load(docRootArgument(argc_, argv_) + "/static/stylus/stylus-state.xml");
+    // Next to the user database, outside of what the static resources serve
+    UserPreferences::instance().load(appRoot() + "../user-preferences.tsv");
+
     // run();
 }
 
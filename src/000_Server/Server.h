@@ -19,9 +19,10 @@ public:
     static Wt::Auth::PasswordService passwordService;
     static std::vector<std::unique_ptr<Wt::Auth::OAuthService>> oAuthServices;
 
+    // Also used by the benchmark target, which runs sessions without a server
+    static void configureAuth();
+
 private:
     int argc_;
     char **argv_;
-
-    void configureAuth();
 };
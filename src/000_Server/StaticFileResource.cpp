@@ -0,0 +1,272 @@
+#include "000_Server/StaticFileResource.h"
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+#include <Wt/Http/ResponseContinuation.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Bytes read and written per continuation, the most a response holds of a file
+const std::size_t CHUNK_BYTES = 256 * 1024;
+
+// Closes the file once the last continuation of a transfer is done with it
+struct OpenFile {
+    explicit OpenFile(int fd) : fd(fd) {}
+    ~OpenFile() { ::close(fd); }
+    OpenFile(const OpenFile&) = delete;
+    OpenFile& operator=(const OpenFile&) = delete;
+
+    int fd;
+};
+
+struct Transfer {
+    std::shared_ptr<OpenFile> file;
+    std::uint64_t offset;   ///< next byte to send
+    std::uint64_t end;      ///< one past the last byte to send
+};
+
+std::string trim(const std::string& text)
+{
+    const std::size_t first = text.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return {};
+    }
+    return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+}
+
+// If-None-Match holds a list of ETags or *, weak ones compare equal to strong ones for a GET
+bool etagMatches(const std::string& header, const std::string& etag)
+{
+    std::size_t start = 0;
+    while (start <= header.size()) {
+        const std::size_t comma = std::min(header.find(',', start), header.size());
+        std::string candidate = trim(header.substr(start, comma - start));
+        if (candidate.rfind("W/", 0) == 0) {
+            candidate = candidate.substr(2);
+        }
+        if (candidate == "*" || candidate == etag) {
+            return true;
+        }
+        start = comma + 1;
+    }
+    return false;
+}
+
+bool parseNumber(const std::string& text, std::uint64_t& value)
+{
+    if (text.empty() || text.find_first_not_of("0123456789") != std::string::npos || text.size() > 19) {
+        return false;
+    }
+    value = std::stoull(text);
+    return true;
+}
+
+enum class RangeResult { None, Satisfiable, Unsatisfiable };
+
+/*
+ * Parses a Range header of a single byte range ("bytes=0-99", "bytes=100-",
+ * "bytes=-500"). Anything else, including several ranges, is ignored and the
+ * whole file is sent, which the specification allows.
+ */
+RangeResult parseRange(const std::string& header, std::uint64_t size, std::uint64_t& first, std::uint64_t& last)
+{
+    const std::string prefix = "bytes=";
+    if (header.compare(0, prefix.size(), prefix) != 0) {
+        return RangeResult::None;
+    }
+    const std::string spec = trim(header.substr(prefix.size()));
+    const std::size_t dash = spec.find('-');
+    if (spec.find(',') != std::string::npos || dash == std::string::npos) {
+        return RangeResult::None;
+    }
+
+    const std::string from = trim(spec.substr(0, dash));
+    const std::string to = trim(spec.substr(dash + 1));
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+    if (from.empty()) {
+        // The last b bytes
+        if (!parseNumber(to, b)) {
+            return RangeResult::None;
+        }
+        if (b == 0 || size == 0) {
+            return RangeResult::Unsatisfiable;
+        }
+        first = size - std::min(b, size);
+        last = size - 1;
+        return RangeResult::Satisfiable;
+    }
+
+    if (!parseNumber(from, a) || (!to.empty() && (!parseNumber(to, b) || b < a))) {
+        return RangeResult::None;
+    }
+    if (a >= size) {
+        return RangeResult::Unsatisfiable;
+    }
+    first = a;
+    last = to.empty() ? size - 1 : std::min(b, size - 1);
+    return RangeResult::Satisfiable;
+}
+
+// Writes the next chunk and schedules a continuation for the rest
+void writeChunk(const Transfer& transfer, Wt::Http::Response& response)
+{
+    const std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(CHUNK_BYTES, transfer.end - transfer.offset));
+    std::vector<char> buffer(length);
+    std::size_t read = 0;
+    while (read < length) {
+        const ssize_t n = ::pread(transfer.file->fd, buffer.data() + read, length - read,
+                                  static_cast<off_t>(transfer.offset + read));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            // Truncated while being sent, the client sees a short body and retries
+            break;
+        }
+        read += static_cast<std::size_t>(n);
+    }
+    response.out().write(buffer.data(), static_cast<std::streamsize>(read));
+
+    const std::uint64_t next = transfer.offset + read;
+    if (read == length && next < transfer.end) {
+        Wt::Http::ResponseContinuation* continuation = response.createContinuation();
+        continuation->setData(Transfer{transfer.file, next, transfer.end});
+    }
+}
+
+}
+
+StaticFileResource::StaticFileResource(std::string directory, Caching caching)
+    : directory_(std::move(directory)),
+      caching_(caching)
+{
+}
+
+StaticFileResource::~StaticFileResource()
+{
+    beingDeleted();
+}
+
+std::string StaticFileResource::mimeType(const std::string& path)
+{
+    static const std::unordered_map<std::string, std::string> MIME_TYPES = {
+        {"js", "application/javascript"},
+        {"css", "text/css"},
+        {"json", "application/json"},
+        {"html", "text/html"},
+        {"svg", "image/svg+xml"},
+        {"png", "image/png"},
+        {"jpg", "image/jpeg"},
+        {"jpeg", "image/jpeg"},
+        {"gif", "image/gif"},
+        {"webp", "image/webp"},
+        {"ttf", "font/ttf"},
+        {"woff", "font/woff"},
+        {"woff2", "font/woff2"},
+        {"xml", "application/xml"},
+        {"txt", "text/plain"},
+        {"mp3", "audio/mpeg"},
+        {"m4a", "audio/mp4"},
+        {"oga", "audio/ogg"},
+        {"ogg", "audio/ogg"},
+        {"wav", "audio/wav"},
+        {"mp4", "video/mp4"},
+        {"m4v", "video/mp4"},
+        {"webm", "video/webm"},
+        {"ogv", "video/ogg"}
+    };
+
+    const std::size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos) {
+        auto it = MIME_TYPES.find(path.substr(dot + 1));
+        if (it != MIME_TYPES.end()) {
+            return it->second;
+        }
+    }
+    return "application/octet-stream";
+}
+
+void StaticFileResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    if (Wt::Http::ResponseContinuation* continuation = request.continuation()) {
+        // The rest of a transfer, from the file it was started with
+        writeChunk(Wt::cpp17::any_cast<Transfer>(continuation->data()), response);
+        return;
+    }
+
+    const std::string path = request.pathInfo();
+    if (path.empty() || path.find("..") != std::string::npos) {
+        response.setStatus(404);
+        return;
+    }
+
+    const int fd = ::open((directory_ + path).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        response.setStatus(404);
+        return;
+    }
+    auto file = std::make_shared<OpenFile>(fd);
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        response.setStatus(404);
+        return;
+    }
+
+    const std::uint64_t size = static_cast<std::uint64_t>(st.st_size);
+    char etag[64];
+    std::snprintf(etag, sizeof(etag), "\"%llx-%llx.%lx\"", static_cast<unsigned long long>(size),
+                  static_cast<unsigned long long>(st.st_mtim.tv_sec), static_cast<long>(st.st_mtim.tv_nsec));
+
+    response.setMimeType(mimeType(path));
+    response.addHeader("ETag", etag);
+    response.addHeader("Accept-Ranges", "bytes");
+    response.addHeader("Cache-Control", caching_ == Caching::Immutable ? "public, max-age=31536000, immutable" : "no-cache");
+
+    const std::string ifNoneMatch = request.headerValue("If-None-Match");
+    if (!ifNoneMatch.empty() && etagMatches(ifNoneMatch, etag)) {
+        response.setStatus(304);
+        return;
+    }
+
+    Transfer transfer{file, 0, size};
+    const std::string range = request.headerValue("Range");
+    const std::string ifRange = request.headerValue("If-Range");
+    if (!range.empty() && (ifRange.empty() || ifRange == etag)) {
+        std::uint64_t first = 0;
+        std::uint64_t last = 0;
+        switch (parseRange(range, size, first, last)) {
+        case RangeResult::Unsatisfiable:
+            response.setStatus(416);
+            response.addHeader("Content-Range", "bytes */" + std::to_string(size));
+            return;
+        case RangeResult::Satisfiable:
+            response.setStatus(206);
+            response.addHeader("Content-Range", "bytes " + std::to_string(first) + "-" + std::to_string(last) + "/"
+                               + std::to_string(size));
+            transfer.offset = first;
+            transfer.end = last + 1;
+            break;
+        case RangeResult::None:
+            break;
+        }
+    }
+
+    response.setContentLength(transfer.end - transfer.offset);
+    if (request.method() == "HEAD" || transfer.offset == transfer.end) {
+        return;
+    }
+    writeChunk(transfer, response);
+}
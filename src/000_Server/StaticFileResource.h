@@ -0,0 +1,44 @@
+#pragma once
+
+#include <Wt/WResource.h>
+
+#include <string>
+
+/**
+ * @brief Serves the files of a directory, streamed in bounded chunks
+ *
+ * Deployed as a static resource, the path after the deployment path selects the
+ * file. The body is read and written one chunk at a time through response
+ * continuations, so a response never holds more than a chunk of the file and a
+ * large download does not keep a request thread for the whole transfer: the
+ * next chunk is only read once the previous one went out.
+ *
+ * Responses carry an ETag from the file's size and modification time, answer
+ * If-None-Match with a 304 and a single byte range (Range, honouring If-Range)
+ * with a 206, which is what media players seek with.
+ */
+class StaticFileResource : public Wt::WResource {
+public:
+    enum class Caching {
+        Immutable,      ///< the URL changes with the content, like vendored libraries under a versioned directory
+        Revalidate      ///< the browser revalidates with the ETag on every use
+    };
+
+    /**
+     * @param directory Directory the request paths are resolved in
+     * @param caching How long browsers may keep a response
+     */
+    explicit StaticFileResource(std::string directory, Caching caching = Caching::Immutable);
+    ~StaticFileResource() override;
+
+    void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+
+    /**
+     * @brief MIME type for a file name, by extension
+     */
+    static std::string mimeType(const std::string& path);
+
+private:
+    std::string directory_;
+    Caching caching_;
+};
@@ -0,0 +1,158 @@
+#include "000_Server/ThumbnailResource.h"
+#include "000_Server/StaticFileResource.h"
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+#include <Wt/Http/ResponseContinuation.h>
+
+#include <sys/stat.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+// Width used when a request does not ask for one, what the images panel shows
+const int DEFAULT_WIDTH = 128;
+
+// Result of a queued variant, shared by the continuation and the completion
+struct Pending {
+    std::mutex mutex;
+    bool done = false;
+    bool busy = false;
+    ThumbnailService::Result result;
+};
+
+struct Transfer {
+    std::string source;
+    std::shared_ptr<Pending> pending;
+};
+
+bool endsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+ThumbnailResource::ThumbnailResource(std::string directory)
+    : directory_(std::move(directory)),
+      waker_(std::make_shared<Waker>())
+{
+    waker_->resource = this;
+}
+
+ThumbnailResource::~ThumbnailResource()
+{
+    {
+        std::lock_guard<std::mutex> lock(waker_->mutex);
+        waker_->resource = nullptr;
+    }
+    beingDeleted();
+}
+
+void ThumbnailResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    if (Wt::Http::ResponseContinuation* continuation = request.continuation()) {
+        // Only resumed by the completion of its own variant, see below
+        const Transfer transfer = Wt::cpp17::any_cast<Transfer>(continuation->data());
+        std::lock_guard<std::mutex> lock(transfer.pending->mutex);
+        const Pending& pending = *transfer.pending;
+        if (pending.busy) {
+            response.setStatus(503);
+            response.addHeader("Retry-After", "1");
+        } else if (pending.result.ok) {
+            serveFile(pending.result.path, "image/png", request, response);
+        } else if (std::filesystem::is_regular_file(transfer.source)) {
+            // Not an image the painter can read, the browser may still show it
+            serveFile(transfer.source, StaticFileResource::mimeType(transfer.source), request, response);
+        } else {
+            response.setStatus(404);
+        }
+        return;
+    }
+
+    const std::string path = request.pathInfo();
+    if (path.empty() || path.find("..") != std::string::npos) {
+        response.setStatus(404);
+        return;
+    }
+    const std::string source = directory_ + path;
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(source, error)) {
+        response.setStatus(404);
+        return;
+    }
+
+    ThumbnailService& service = ThumbnailService::instance();
+    if (!ThumbnailService::available() || endsWith(source, ".svg")) {
+        serveFile(source, StaticFileResource::mimeType(source), request, response);
+        return;
+    }
+
+    const std::string* requested = request.getParameter("w");
+    const int width = ThumbnailService::variantWidth(requested ? std::atoi(requested->c_str()) : DEFAULT_WIDTH);
+    std::string variant;
+    if (service.cached(source, width, variant)) {
+        serveFile(variant, "image/png", request, response);
+        return;
+    }
+
+    // Waiting before queueing, a completion can never come before the continuation waits
+    auto pending = std::make_shared<Pending>();
+    Wt::Http::ResponseContinuation* continuation = response.createContinuation();
+    continuation->setData(Transfer{source, pending});
+    continuation->waitForMoreData();
+
+    // The completion resumes just this request. WResource::haveMoreData() would
+    // resume every waiting one, each re-parking until its own variant is done.
+    std::weak_ptr<Wt::Http::ResponseContinuation> waiting = continuation->shared_from_this();
+    std::shared_ptr<Waker> waker = waker_;
+    const bool queued = service.request(source, width, [pending, waker, waiting](const ThumbnailService::Result& result) {
+        {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            pending->result = result;
+            pending->done = true;
+        }
+        std::lock_guard<std::mutex> lock(waker->mutex);
+        auto continuation = waiting.lock();
+        if (waker->resource && continuation) {
+            continuation->haveMoreData();
+        }
+    });
+    if (!queued) {
+        {
+            std::lock_guard<std::mutex> lock(pending->mutex);
+            pending->busy = true;
+            pending->done = true;
+        }
+        continuation->haveMoreData();
+    }
+}
+
+void ThumbnailResource::serveFile(const std::string& path, const std::string& mimeType,
+                                  const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        response.setStatus(404);
+        return;
+    }
+    const std::string etag = "\"" + std::filesystem::path(path).filename().string() + "-" + std::to_string(st.st_size)
+        + "-" + std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec) + "\"";
+    response.setMimeType(mimeType);
+    response.addHeader("ETag", etag);
+    response.addHeader("Cache-Control", request.getParameter("v") ? "public, max-age=31536000, immutable" : "no-cache");
+    if (request.headerValue("If-None-Match") == etag) {
+        response.setStatus(304);
+        return;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        response.setStatus(404);
+        return;
+    }
+    response.out() << file.rdbuf();
+}
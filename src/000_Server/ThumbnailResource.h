@@ -0,0 +1,47 @@
+#pragma once
+
+#include "009_Services/ThumbnailService.h"
+
+#include <Wt/WResource.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Serves resized variants of the images of a directory
+ *
+ * Deployed as a static resource, the path after the deployment path selects the
+ * image and ?w= the width, rounded up by ThumbnailService::variantWidth(). A
+ * variant already on disk is served right away. Otherwise it is queued with the
+ * ThumbnailService and the request waits in a response continuation, so the
+ * request thread is free while the image is resized. The completion of a variant
+ * resumes only the continuation of its own request.
+ *
+ * Responses carry an ETag from the content hash. URLs with a ?v= version, which
+ * the Stylus images panel sets from the file's mtime, are cached as immutable.
+ * SVGs, and every image when resizing is not available, are served as is.
+ */
+class ThumbnailResource : public Wt::WResource {
+public:
+    /**
+     * @param directory Directory the request paths are resolved in
+     */
+    explicit ThumbnailResource(std::string directory);
+    ~ThumbnailResource() override;
+
+    void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+
+private:
+    // Lets completions outlive the resource, they only resume its requests while it exists
+    struct Waker {
+        std::mutex mutex;
+        ThumbnailResource* resource = nullptr;
+    };
+
+    void serveFile(const std::string& path, const std::string& mimeType, const Wt::Http::Request& request,
+                   Wt::Http::Response& response);
+
+    std::string directory_;
+    std::shared_ptr<Waker> waker_;
+};
@@ -2,8 +2,10 @@
 // #include "006-Navigation/Navigation.h"
 
 #include "004_Theme/DarkModeToggle.h"
+#include "006_Stylus/Stylus.h"
 // #include "004_Theme/ThemeSwitcher.h"
 #include "008_ApplicationShell/SidebarLayout.h"
+#include "009_Services/TemplateHotSwap.h"
 
 // #include "005_Components/ComponentsDisplay.h"
 // #include "008-AboutMe/AboutMe.h"
@@ -57,6 +59,10 @@ App::App(const Wt::WEnvironment& env)
 
     setTheme(std::make_shared<Theme>());
 
+    // Bundles saved in Stylus and rebuilt stylesheets are pushed to every live
+    // session, attached before any widget is built so its templates are watched
+    TemplateHotSwap::instance().attach();
+
     authDialog_ = wApp->root()->addNew<Wt::WDialog>("");
     authDialog_->keyWentDown().connect([=](Wt::WKeyEvent e) {
         wApp->globalKeyWentDown().emit(e); // Emit the global key event
@@ -75,7 +81,6 @@ App::App(const Wt::WEnvironment& env)
     authWidget_ = authDialog_->contents()->addWidget(std::make_unique<AuthWidget>(session_));
 
     appRoot_ = root()->addNew<Wt::WContainerWidget>();
-    stylus_ = root()->addChild(std::make_unique<Stylus::Stylus>(session_));
     
     session_.login().changed().connect(this, &App::authEvent);
     authWidget_->processEnvironment();
@@ -90,9 +95,13 @@ App::App(const Wt::WEnvironment& env)
     wApp->globalKeyWentDown().connect([=](Wt::WKeyEvent e)
     {
         // Handle global key events here
+        if(e.modifiers().test(Wt::KeyboardModifier::Alt) && e.key() == Wt::Key::Q){
+            toggleStylus();
+        }
         if(e.modifiers().test(Wt::KeyboardModifier::Shift)){
             if(e.key() == Wt::Key::Q){
                 if(authDialog_->isHidden()){
+                    Theme::useStyleSheetChunk("auth");
                     authDialog_->show();
                 }else {
                     authDialog_->hide();
@@ -105,6 +114,11 @@ App::App(const Wt::WEnvironment& env)
     wApp->internalPathChanged().emit(wApp->internalPath());
 }
 
+App::~App()
+{
+    TemplateHotSwap::instance().detach();
+}
+
 void App::authEvent() {
     if (session_.login().loggedIn()) {
         const Wt::Auth::User& u = session_.login().user();
@@ -125,12 +139,25 @@ void App::authEvent() {
     createApp();
 }
 
+void App::toggleStylus()
+{
+    if (!stylus_permission_) {
+        return;
+    }
+    if (stylus_ == nullptr) {
+        stylus_ = root()->addChild(std::make_unique<Stylus::Stylus>(session_));
+    }
+    stylus_->toggle();
+}
+
 void App::createApp()
 {
     if (appRoot_ != nullptr && !appRoot_->children().empty()) {
         appRoot_->clear();
     }
 
+    stylus_permission_ = false;
+
     if (session_.login().loggedIn()) {
         Wt::Dbo::Transaction transaction(session_);
 
@@ -143,6 +170,7 @@ void App::createApp()
             #ifdef DEBUG
             Wt::log("debug") << "Permission STYLUS found, Stylus will be available.";
             #endif
+            stylus_permission_ = true;
             // stylus_ = appRoot_->addChild(std::make_unique<Stylus::Stylus>(session_));
         } else {
             #ifdef DEBUG
@@ -152,6 +180,12 @@ void App::createApp()
         transaction.commit();
     }
 
+    // A user logging out or switching accounts must not keep the editor
+    if (!stylus_permission_ && stylus_ != nullptr) {
+        root()->removeChild(stylus_);
+        stylus_ = nullptr;
+    }
+
     auto sidebarLayout = appRoot_->addNew<SidebarLayout>(session_);
 
 
@@ -4,7 +4,6 @@
 
 #include "002_Dbo/Session.h"
 
-#include "006_Stylus/Stylus.h"
 #include "003_Auth/AuthWidget.h"
 #include "004_Theme/Theme.h"
 
@@ -13,10 +12,17 @@ namespace Wt {
     class WDialog;
 }
 
+namespace Stylus {
+    class Stylus;
+}
+
 class App : public Wt::WApplication
 {
 public:
     App(const Wt::WEnvironment& env);
+    ~App() override;
+
+    Session& session() { return session_; }
 
     // Wt::Signal<bool> dark_mode_changed_;
     // Wt::Signal<ThemeConfig> theme_changed_;
@@ -25,7 +31,10 @@ private:
     Wt::WDialog* authDialog_ = nullptr;
     Session session_;
     Stylus::Stylus* stylus_ = nullptr;
+    bool stylus_permission_ = false;
     void authEvent();
+    // Constructs Stylus on first use, only for users with the STYLUS permission
+    void toggleStylus();
     // Wt::WContainerWidget* app_content_;
     void createApp();
     AuthWidget* authWidget_ = nullptr;
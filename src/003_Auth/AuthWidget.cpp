@@ -4,6 +4,8 @@
 #include "003_Auth/UserDetailsModel.h"
 #include "002_Dbo/Tables/User.h"
 #include "002_Dbo/Tables/Permission.h"
+#include "004_Theme/Theme.h"
+#include "009_Services/TemplateHotSwap.h"
 
 #include <Wt/Auth/PasswordService.h>
 #include <Wt/WApplication.h>
@@ -48,6 +50,7 @@ std::unique_ptr<Wt::WWidget> AuthWidget::createRegistrationView(const Wt::Auth::
 void AuthWidget::createLoginView()
 {
   setTemplateText(tr(loginTemplateId_)); // default wt template
+  TemplateHotSwap::instance().watch(this);
   // setTemplateText(tr("Wt.Auth.template.login-v0")); // v0 nothing but the data and some basic structure
   // setTemplateText(tr("Wt.Auth.template.login-v1")); // custom implementation v1
 
@@ -99,6 +102,7 @@ void AuthWidget::createLoginView()
 Wt::WDialog *AuthWidget::showDialog(const Wt::WString& title, std::unique_ptr<Wt::WWidget> contents) 
 {
   if (contents) {
+    Theme::useStyleSheetChunk("auth");
     dialog_ = std::make_unique<Wt::WDialog>(title);
     dialog_->contents()->addWidget(std::move(contents));
     dialog_->setMinimumSize(Wt::WLength(100, Wt::LengthUnit::ViewportWidth), Wt::WLength(100, Wt::LengthUnit::ViewportHeight));
@@ -1,5 +1,6 @@
 #include "003_Auth/RegistrationView.h"
 #include "003_Auth/UserDetailsModel.h"
+#include "009_Services/TemplateHotSwap.h"
 
 
 RegistrationView::RegistrationView(Session& session, Wt::Auth::AuthWidget *authWidget)
@@ -7,6 +8,7 @@ RegistrationView::RegistrationView(Session& session, Wt::Auth::AuthWidget *authW
     session_(session)
 {
   setTemplateText(tr("template.registration"));
+  TemplateHotSwap::instance().watch(this);
   detailsModel_ = std::make_unique<UserDetailsModel>(session_);
 
   updateView(detailsModel_.get());
@@ -0,0 +1,195 @@
+#include "004_Theme/CssPrune.h"
+
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace Css {
+
+namespace {
+
+const std::set<std::string> SOURCE_EXTENSIONS = {".xml", ".cpp", ".h", ".js", ".html"};
+
+void scanSource(const fs::path& path, std::unordered_set<std::string>& used, PruneReport& report)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        report.missingSources.push_back(path.string());
+        return;
+    }
+    std::ostringstream content;
+    content << file.rdbuf();
+    collectClassCandidates(content.str(), used);
+    ++report.sourceFiles;
+}
+
+void scanSources(const std::vector<std::string>& sources, std::unordered_set<std::string>& used, PruneReport& report)
+{
+    for (const std::string& source : sources) {
+        const fs::path path(source);
+        std::error_code ec;
+        if (fs::is_directory(path, ec)) {
+            for (const auto& entry : fs::recursive_directory_iterator(path, ec)) {
+                if (entry.is_regular_file() && SOURCE_EXTENSIONS.count(entry.path().extension().string())) {
+                    scanSource(entry.path(), used, report);
+                }
+            }
+        } else if (fs::is_regular_file(path, ec)) {
+            scanSource(path, used, report);
+        } else {
+            report.missingSources.push_back(source);
+        }
+    }
+    report.candidates = used.size();
+}
+
+bool selectorUsed(const std::string& selector, const std::unordered_set<std::string>& used)
+{
+    for (const std::string& cls : selectorClasses(selector)) {
+        if (!used.count(cls)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Keeps the selectors whose classes are all in `used`. When `core` is given the
+ * rules are being split into a chunk: selectors the core chunk already carries
+ * and all non-style rules are left out.
+ */
+void pruneRules(std::vector<Rule>& rules, const std::unordered_set<std::string>& used,
+                const std::unordered_set<std::string>* core, std::vector<std::string>& removedSelectors)
+{
+    std::vector<Rule> kept;
+    kept.reserve(rules.size());
+
+    for (Rule& rule : rules) {
+        if (rule.kind == Rule::Kind::Style && rule.hasBlock) {
+            std::string prelude;
+            for (const std::string& selector : splitSelectors(rule.prelude)) {
+                if (!selectorUsed(selector, used)) {
+                    removedSelectors.push_back(selector);
+                } else if (!core || !selectorUsed(selector, *core)) {
+                    prelude += prelude.empty() ? selector : "," + selector;
+                }
+            }
+            if (prelude.empty()) {
+                continue;
+            }
+            rule.prelude = prelude;
+        } else if (rule.kind == Rule::Kind::Group) {
+            pruneRules(rule.children, used, core, removedSelectors);
+            if (rule.children.empty()) {
+                continue;
+            }
+        } else if (core) {
+            continue;
+        }
+        kept.push_back(std::move(rule));
+    }
+
+    rules = std::move(kept);
+}
+
+void collectStyleBodies(const std::vector<Rule>& rules, std::string& bodies)
+{
+    for (const Rule& rule : rules) {
+        if (rule.kind == Rule::Kind::Style) {
+            bodies += rule.body;
+            bodies += ';';
+        } else if (rule.kind == Rule::Kind::Group) {
+            collectStyleBodies(rule.children, bodies);
+        }
+    }
+}
+
+// @keyframes only referenced by removed utilities (animate-spin, ...) go as well
+void pruneKeyframes(std::vector<Rule>& rules, const std::string& bodies, std::vector<std::string>& removedKeyframes)
+{
+    std::vector<Rule> kept;
+    for (Rule& rule : rules) {
+        if (rule.kind == Rule::Kind::AtRule && atRuleName(rule.prelude) == "keyframes") {
+            const std::string name = rule.prelude.substr(rule.prelude.find_first_of(" \t") + 1);
+            if (bodies.find(name) == std::string::npos) {
+                removedKeyframes.push_back(name);
+                continue;
+            }
+        } else if (rule.kind == Rule::Kind::Group) {
+            pruneKeyframes(rule.children, bodies, removedKeyframes);
+        }
+        kept.push_back(std::move(rule));
+    }
+    rules = std::move(kept);
+}
+
+}
+
+PruneSpec projectPruneSpec(const std::string& root)
+{
+    const std::string src = root + "/src/";
+    const std::string xml = root + "/static/0_stylus/xml/";
+    const std::string js = root + "/static/js";
+
+    PruneSpec spec;
+    spec.sources = {xml, src, js};
+    spec.chunks = {
+        {"core", {src + "000_Server", src + "001_App", src + "002_Dbo", src + "004_Theme",
+                  src + "008_ApplicationShell", xml + "000_General"}},
+        {"auth", {src + "003_Auth", xml + "001_Auth"}},
+        {"stylus", {src + "005_Components", src + "006_Stylus", src + "007_State", xml + "002_Stylus", js}},
+    };
+    return spec;
+}
+
+std::vector<Rule> prune(std::vector<Rule> rules, const std::vector<std::string>& sources, PruneReport& report)
+{
+    std::unordered_set<std::string> used;
+    scanSources(sources, used, report);
+    pruneRules(rules, used, nullptr, report.removedSelectors);
+
+    std::string bodies;
+    collectStyleBodies(rules, bodies);
+    pruneKeyframes(rules, bodies, report.removedKeyframes);
+    return rules;
+}
+
+std::vector<std::string> splitChunks(const std::vector<Rule>& rules, const std::vector<Chunk>& chunks)
+{
+    std::unordered_set<std::string> core;
+    std::vector<std::vector<Rule>> chunkRules;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        PruneReport chunkReport;
+        std::unordered_set<std::string> used = core;
+        scanSources(chunks[i].sources, used, chunkReport);
+
+        chunkRules.push_back(rules);
+        pruneRules(chunkRules.back(), used, i == 0 ? nullptr : &core, chunkReport.removedSelectors);
+        if (i == 0) {
+            core = std::move(used);
+        }
+    }
+
+    // Keyframes are only kept in the core chunk, for whichever chunk needs them
+    std::vector<std::string> sheets;
+    if (chunkRules.empty()) {
+        return sheets;
+    }
+    std::string bodies;
+    for (const auto& chunk : chunkRules) {
+        collectStyleBodies(chunk, bodies);
+    }
+    std::vector<std::string> removedKeyframes;
+    pruneKeyframes(chunkRules.front(), bodies, removedKeyframes);
+
+    for (const auto& chunk : chunkRules) {
+        sheets.push_back(serialize(chunk));
+    }
+    return sheets;
+}
+
+}
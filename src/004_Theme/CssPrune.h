@@ -0,0 +1,62 @@
+#pragma once
+
+#include "004_Theme/CssRules.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Drops the Tailwind rules nothing uses and splits the rest into route chunks
+ *
+ * Shared by the tailwind-prune tool (the prune-css target) and TailwindBuilder,
+ * which runs it after every build, so both write the same files. Like CssRules
+ * it does not depend on Wt.
+ */
+namespace Css {
+
+struct PruneReport {
+    std::vector<std::string> removedSelectors;
+    std::vector<std::string> removedKeyframes;
+    std::vector<std::string> missingSources;    ///< listed sources that do not exist or cannot be read
+    std::size_t sourceFiles = 0;
+    std::size_t candidates = 0;
+};
+
+struct Chunk {
+    std::string name;
+    std::vector<std::string> sources;           ///< files or directories scanned for classes
+};
+
+struct PruneSpec {
+    std::vector<std::string> sources;           ///< everything that may use a class
+    std::vector<Chunk> chunks;                  ///< the first one is the core chunk
+};
+
+/**
+ * @brief Sources and route chunks of this project
+ * @param root Project directory, the document root when the server runs from the source tree
+ *
+ * The core chunk gets the server, app, theme and shell sources and the general
+ * templates, the auth and stylus chunks their own sources and templates.
+ */
+PruneSpec projectPruneSpec(const std::string& root);
+
+/**
+ * @brief Keeps the rules whose classes are all used by the sources
+ *
+ * @keyframes only referenced by removed rules go as well.
+ */
+std::vector<Rule> prune(std::vector<Rule> rules, const std::vector<std::string>& sources, PruneReport& report);
+
+/**
+ * @brief Splits pruned rules into one stylesheet per chunk
+ * @return The stylesheets in the order of the chunks
+ *
+ * The first chunk is the core chunk and gets every rule its sources use plus the
+ * non-style rules (@property, @keyframes, ...). Every later chunk gets only the
+ * rules its own sources add on top of the core chunk.
+ */
+std::vector<std::string> splitChunks(const std::vector<Rule>& rules, const std::vector<Chunk>& chunks);
+
+}
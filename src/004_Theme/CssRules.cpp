@@ -0,0 +1,368 @@
+#include "004_Theme/CssRules.h"
+
+#include <cctype>
+#include <cstring>
+
+namespace Css {
+
+namespace {
+
+bool isSpace(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+std::string trim(const std::string& text)
+{
+    std::size_t begin = 0;
+    std::size_t end = text.size();
+    while (begin < end && isSpace(text[begin])) {
+        ++begin;
+    }
+    while (end > begin && isSpace(text[end - 1])) {
+        --end;
+    }
+    return text.substr(begin, end - begin);
+}
+
+// Skips a quoted string starting at pos, returns the index just past the closing quote
+std::size_t skipString(const std::string& css, std::size_t pos)
+{
+    const char quote = css[pos++];
+    while (pos < css.size() && css[pos] != quote) {
+        if (css[pos] == '\\') {
+            ++pos;
+        }
+        ++pos;
+    }
+    return pos < css.size() ? pos + 1 : pos;
+}
+
+// Skips a comment starting at pos, returns the index just past `*/`
+std::size_t skipComment(const std::string& css, std::size_t pos)
+{
+    const std::size_t end = css.find("*/", pos + 2);
+    return end == std::string::npos ? css.size() : end + 2;
+}
+
+// Returns the index of the `}` matching the `{` at pos
+std::size_t findBlockEnd(const std::string& css, std::size_t pos)
+{
+    int depth = 0;
+    while (pos < css.size()) {
+        const char c = css[pos];
+        if (c == '\\') {
+            pos += 2;
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            pos = skipString(css, pos);
+            continue;
+        }
+        if (c == '/' && pos + 1 < css.size() && css[pos + 1] == '*') {
+            pos = skipComment(css, pos);
+            continue;
+        }
+        if (c == '{') {
+            ++depth;
+        } else if (c == '}') {
+            if (--depth == 0) {
+                return pos;
+            }
+        }
+        ++pos;
+    }
+    return css.size();
+}
+
+bool isGroupingAtRule(const std::string& name)
+{
+    return name == "media" || name == "supports" || name == "layer"
+        || name == "container" || name == "scope" || name == "starting-style";
+}
+
+bool isIdentChar(unsigned char c)
+{
+    return std::isalnum(c) || c == '-' || c == '_' || c >= 0x80;
+}
+
+unsigned hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return static_cast<unsigned>(c - '0');
+    }
+    return static_cast<unsigned>(std::tolower(static_cast<unsigned char>(c)) - 'a' + 10);
+}
+
+void appendCodePoint(std::string& out, unsigned long cp)
+{
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+void parseRules(const std::string& css, std::vector<Rule>& rules)
+{
+    std::size_t pos = 0;
+    while (pos < css.size()) {
+        if (isSpace(css[pos])) {
+            ++pos;
+            continue;
+        }
+
+        if (css.compare(pos, 2, "/*") == 0) {
+            const std::size_t end = skipComment(css, pos);
+            Rule comment;
+            comment.kind = Rule::Kind::Comment;
+            comment.prelude = css.substr(pos, end - pos);
+            comment.hasBlock = false;
+            rules.push_back(std::move(comment));
+            pos = end;
+            continue;
+        }
+
+        // Read the prelude up to the block or the end of the statement
+        const std::size_t start = pos;
+        int parens = 0;
+        while (pos < css.size()) {
+            const char c = css[pos];
+            if (c == '\\') {
+                pos += 2;
+                continue;
+            }
+            if (c == '"' || c == '\'') {
+                pos = skipString(css, pos);
+                continue;
+            }
+            if (c == '(' || c == '[') {
+                ++parens;
+            } else if (c == ')' || c == ']') {
+                --parens;
+            } else if (parens <= 0 && (c == '{' || c == ';' || c == '}')) {
+                break;
+            }
+            ++pos;
+        }
+
+        Rule rule;
+        rule.prelude = trim(css.substr(start, pos - start));
+
+        if (pos >= css.size() || css[pos] == ';' || css[pos] == '}') {
+            if (!rule.prelude.empty()) {
+                rule.kind = rule.prelude[0] == '@' ? Rule::Kind::AtRule : Rule::Kind::Style;
+                rule.hasBlock = false;
+                rules.push_back(std::move(rule));
+            }
+            ++pos;
+            continue;
+        }
+
+        const std::size_t end = findBlockEnd(css, pos);
+        const std::string body = css.substr(pos + 1, end - pos - 1);
+        pos = end + 1;
+
+        if (rule.prelude[0] == '@') {
+            if (isGroupingAtRule(atRuleName(rule.prelude))) {
+                rule.kind = Rule::Kind::Group;
+                parseRules(body, rule.children);
+            } else {
+                rule.kind = Rule::Kind::AtRule;
+                rule.body = body;
+            }
+        } else {
+            rule.kind = Rule::Kind::Style;
+            rule.body = body;
+        }
+        rules.push_back(std::move(rule));
+    }
+}
+
+void serializeRules(const std::vector<Rule>& rules, std::string& out)
+{
+    for (const Rule& rule : rules) {
+        out += rule.prelude;
+        switch (rule.kind) {
+        case Rule::Kind::Comment:
+            out += '\n';
+            break;
+        case Rule::Kind::Group:
+            out += '{';
+            serializeRules(rule.children, out);
+            out += '}';
+            break;
+        case Rule::Kind::Style:
+        case Rule::Kind::AtRule:
+            if (rule.hasBlock) {
+                out += '{';
+                out += rule.body;
+                out += '}';
+            } else {
+                out += ';';
+            }
+            break;
+        }
+    }
+}
+
+}
+
+std::vector<Rule> parse(const std::string& css)
+{
+    std::vector<Rule> rules;
+    parseRules(css, rules);
+    return rules;
+}
+
+std::string serialize(const std::vector<Rule>& rules)
+{
+    std::string out;
+    serializeRules(rules, out);
+    return out;
+}
+
+std::vector<std::string> splitSelectors(const std::string& selectorList)
+{
+    std::vector<std::string> selectors;
+    std::size_t start = 0;
+    std::size_t pos = 0;
+    int depth = 0;
+    while (pos < selectorList.size()) {
+        const char c = selectorList[pos];
+        if (c == '\\') {
+            pos += 2;
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            pos = skipString(selectorList, pos);
+            continue;
+        }
+        if (c == '(' || c == '[') {
+            ++depth;
+        } else if (c == ')' || c == ']') {
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            selectors.push_back(trim(selectorList.substr(start, pos - start)));
+            start = pos + 1;
+        }
+        ++pos;
+    }
+    selectors.push_back(trim(selectorList.substr(start)));
+    return selectors;
+}
+
+std::vector<std::string> selectorClasses(const std::string& selector)
+{
+    std::vector<std::string> classes;
+    std::size_t pos = 0;
+    int brackets = 0;
+    while (pos < selector.size()) {
+        const char c = selector[pos];
+        if (c == '\\') {
+            pos += 2;
+            continue;
+        }
+        if (c == '"' || c == '\'') {
+            pos = skipString(selector, pos);
+            continue;
+        }
+        if (c == '[') {
+            ++brackets;
+        } else if (c == ']') {
+            --brackets;
+        } else if (c == '.' && brackets == 0) {
+            std::string name;
+            ++pos;
+            while (pos < selector.size()) {
+                const unsigned char n = static_cast<unsigned char>(selector[pos]);
+                if (n == '\\' && pos + 1 < selector.size()) {
+                    ++pos;
+                    if (std::isxdigit(static_cast<unsigned char>(selector[pos]))) {
+                        std::size_t digits = 0;
+                        unsigned long cp = 0;
+                        while (digits < 6 && pos < selector.size()
+                               && std::isxdigit(static_cast<unsigned char>(selector[pos]))) {
+                            cp = cp * 16 + hexValue(selector[pos]);
+                            ++pos;
+                            ++digits;
+                        }
+                        if (pos < selector.size() && selector[pos] == ' ') {
+                            ++pos;
+                        }
+                        appendCodePoint(name, cp);
+                    } else {
+                        name += selector[pos++];
+                    }
+                } else if (isIdentChar(n)) {
+                    name += selector[pos++];
+                } else {
+                    break;
+                }
+            }
+            if (!name.empty()) {
+                classes.push_back(std::move(name));
+            }
+            continue;
+        }
+        ++pos;
+    }
+    return classes;
+}
+
+std::string atRuleName(const std::string& prelude)
+{
+    if (prelude.empty() || prelude[0] != '@') {
+        return {};
+    }
+    std::size_t end = 1;
+    while (end < prelude.size() && isIdentChar(static_cast<unsigned char>(prelude[end]))) {
+        ++end;
+    }
+    return prelude.substr(1, end - 1);
+}
+
+void collectClassCandidates(const std::string& text, std::unordered_set<std::string>& candidates)
+{
+    static const char* TOKEN_DELIMITERS = "\"`";
+    static const char* PIECE_DELIMITERS = "<>=;{}(),'\\";
+
+    std::size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && (isSpace(text[pos]) || std::strchr(TOKEN_DELIMITERS, text[pos]))) {
+            ++pos;
+        }
+        const std::size_t start = pos;
+        while (pos < text.size() && !isSpace(text[pos]) && !std::strchr(TOKEN_DELIMITERS, text[pos])) {
+            ++pos;
+        }
+        if (pos == start) {
+            continue;
+        }
+
+        const std::string token = text.substr(start, pos - start);
+        candidates.insert(token);
+
+        std::size_t pieceStart = 0;
+        for (std::size_t i = 0; i <= token.size(); ++i) {
+            if (i == token.size() || std::strchr(PIECE_DELIMITERS, token[i])) {
+                if (i > pieceStart && (pieceStart != 0 || i != token.size())) {
+                    candidates.insert(token.substr(pieceStart, i - pieceStart));
+                }
+                pieceStart = i + 1;
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief Minimal CSS reader used to work with the compiled Tailwind stylesheet
+ *
+ * Only understands as much CSS as needed to walk the rule tree: grouping
+ * at-rules (@layer, @media, @supports, @container) are parsed recursively, style
+ * rules and every other at-rule keep their body as raw text. Does not depend on Wt
+ * so build tools can link it as well.
+ */
+namespace Css {
+
+struct Rule {
+    enum class Kind {
+        Style,      ///< selector list with a declaration block
+        Group,      ///< grouping at-rule whose block holds more rules
+        AtRule,     ///< any other at-rule (@property, @keyframes, @import ...)
+        Comment     ///< comment kept verbatim (license banners)
+    };
+
+    Kind kind = Kind::Style;
+    std::string prelude;            ///< selector list or at-rule prelude, trimmed
+    std::string body;               ///< raw block contents, unused for Group
+    bool hasBlock = true;           ///< false for statement at-rules (`@layer a, b;`)
+    std::vector<Rule> children;     ///< nested rules of a Group
+};
+
+/**
+ * @brief Parses a stylesheet into its rule tree
+ */
+std::vector<Rule> parse(const std::string& css);
+
+/**
+ * @brief Writes a rule tree back out without optional whitespace
+ */
+std::string serialize(const std::vector<Rule>& rules);
+
+/**
+ * @brief Splits a selector list on its top-level commas
+ */
+std::vector<std::string> splitSelectors(const std::string& selectorList);
+
+/**
+ * @brief Returns the unescaped class names a selector refers to
+ *
+ * `.hover\:bg-gray-100:hover` yields `hover:bg-gray-100`.
+ */
+std::vector<std::string> selectorClasses(const std::string& selector);
+
+/**
+ * @brief Returns the at-rule name of a prelude (`@media (...)` yields `media`)
+ */
+std::string atRuleName(const std::string& prelude);
+
+/**
+ * @brief Adds every token of a template/source text that may be used as a class
+ *
+ * Deliberately over-approximates: a token is added as a whole and split on the
+ * markup and code punctuation around it, so both `class="flex"` and
+ * `[&>input]:hidden` are found.
+ */
+void collectClassCandidates(const std::string& text, std::unordered_set<std::string>& candidates);
+
+}
@@ -0,0 +1,210 @@
+#include "004_Theme/TailwindIndexResource.h"
+#include "004_Theme/CssRules.h"
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+#include <Wt/WLogger.h>
+
+#include <sys/stat.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Long declaration blocks (gradients, shadows) are cut, they are only shown as a hint
+const std::size_t MAX_DETAIL = 120;
+
+// Utilities Tailwind generates from a @theme namespace, with the property they set
+const std::vector<std::pair<std::string, std::vector<std::pair<std::string, std::string>>>> THEME_UTILITIES = {
+    {"--color-", {
+        {"bg-", "background-color"}, {"text-", "color"}, {"border-", "border-color"},
+        {"outline-", "outline-color"}, {"ring-", "--tw-ring-color"}, {"divide-", "border-color"},
+        {"fill-", "fill"}, {"stroke-", "stroke"}, {"placeholder-", "color"}, {"accent-", "accent-color"}
+    }},
+    {"--font-", {{"font-", "font-family"}}},
+    {"--text-", {{"text-", "font-size"}}},
+    {"--radius-", {{"rounded-", "border-radius"}}},
+    {"--shadow-", {{"shadow-", "box-shadow"}}}
+};
+
+bool readFile(const std::string& path, std::string& content)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    content = stream.str();
+    return true;
+}
+
+std::string fileVersion(const std::string& path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return "-";
+    }
+    return std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec) + "-" + std::to_string(st.st_size);
+}
+
+// `hover:bg-gray-400` is offered as `bg-gray-400`, the client keeps what the user typed before the last ':'
+std::string withoutVariants(const std::string& cls)
+{
+    int depth = 0;
+    std::size_t start = 0;
+    for (std::size_t i = 0; i < cls.size(); ++i) {
+        if (cls[i] == '[') {
+            ++depth;
+        } else if (cls[i] == ']') {
+            --depth;
+        } else if (cls[i] == ':' && depth == 0) {
+            start = i + 1;
+        }
+    }
+    return cls.substr(start);
+}
+
+std::string compact(const std::string& body)
+{
+    std::string result;
+    bool space = false;
+    for (char c : body) {
+        if (c == '\n' || c == '\t' || c == ' ') {
+            space = !result.empty();
+            continue;
+        }
+        if (space) {
+            result += ' ';
+            space = false;
+        }
+        result += c;
+    }
+    if (result.size() > MAX_DETAIL) {
+        result = result.substr(0, MAX_DETAIL) + "...";
+    }
+    return result;
+}
+
+void collectUtilities(const std::vector<Css::Rule>& rules, std::map<std::string, std::string>& utilities)
+{
+    for (const Css::Rule& rule : rules) {
+        if (rule.kind == Css::Rule::Kind::Group) {
+            collectUtilities(rule.children, utilities);
+        } else if (rule.kind == Css::Rule::Kind::Style) {
+            for (const std::string& selector : Css::splitSelectors(rule.prelude)) {
+                const std::vector<std::string> classes = Css::selectorClasses(selector);
+                // Only selectors made of one class define a utility
+                if (classes.size() == 1) {
+                    utilities.emplace(withoutVariants(classes.front()), compact(rule.body));
+                }
+            }
+        }
+    }
+}
+
+// The custom properties of every @theme block, `--color-primary: ...` gives `bg-primary`, ...
+void collectThemeUtilities(const std::vector<Css::Rule>& rules, std::map<std::string, std::string>& utilities)
+{
+    for (const Css::Rule& rule : rules) {
+        if (rule.kind != Css::Rule::Kind::AtRule || Css::atRuleName(rule.prelude) != "theme") {
+            continue;
+        }
+        std::stringstream declarations(rule.body);
+        std::string declaration;
+        while (std::getline(declarations, declaration, ';')) {
+            const std::size_t start = declaration.find("--");
+            const std::size_t colon = declaration.find(':', start);
+            if (start == std::string::npos || colon == std::string::npos) {
+                continue;
+            }
+            const std::string property = declaration.substr(start, colon - start);
+            for (const auto& ns : THEME_UTILITIES) {
+                if (property.rfind(ns.first, 0) != 0 || property.size() == ns.first.size()) {
+                    continue;
+                }
+                const std::string name = property.substr(ns.first.size());
+                for (const auto& utility : ns.second) {
+                    utilities.emplace(utility.first + name, utility.second + ":var(" + property + ")");
+                }
+            }
+        }
+    }
+}
+
+}
+
+TailwindIndexResource::TailwindIndexResource(std::string docRoot)
+    : cssPath_(docRoot + "/static/css/tailwind.minify.css"),
+      inputPath_(docRoot + "/static/0_stylus/tailwind/input.css")
+{
+}
+
+TailwindIndexResource::~TailwindIndexResource()
+{
+    beingDeleted();
+}
+
+std::string TailwindIndexResource::build(const std::string& compiledCss, const std::string& inputCss)
+{
+    std::map<std::string, std::string> utilities;
+    collectUtilities(Css::parse(compiledCss), utilities);
+    collectThemeUtilities(Css::parse(inputCss), utilities);
+
+    // Class names and declarations are plain ASCII apart from quotes and backslashes
+    auto quoted = [](const std::string& text) {
+        std::string result = "\"";
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            if (static_cast<unsigned char>(c) >= 0x20) {
+                result += c;
+            }
+        }
+        return result + "\"";
+    };
+
+    std::string classes;
+    std::string details;
+    for (const auto& utility : utilities) {
+        classes += (classes.empty() ? "" : ",") + quoted(utility.first);
+        details += (details.empty() ? "" : ",") + quoted(utility.second);
+    }
+    return "{\"classes\":[" + classes + "],\"details\":[" + details + "]}";
+}
+
+void TailwindIndexResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    std::string etag;
+    std::string json;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::string version = "\"" + fileVersion(cssPath_) + "/" + fileVersion(inputPath_) + "\"";
+        if (version != etag_) {
+            std::string css;
+            std::string input;
+            if (!readFile(cssPath_, css)) {
+                Wt::log("error") << "TailwindIndexResource: cannot read " << cssPath_;
+            }
+            readFile(inputPath_, input);
+            json_ = build(css, input);
+            etag_ = version;
+        }
+        etag = etag_;
+        json = json_;
+    }
+
+    response.setMimeType("application/json");
+    response.addHeader("ETag", etag);
+    response.addHeader("Cache-Control", "no-cache");
+    if (request.headerValue("If-None-Match") == etag) {
+        response.setStatus(304);
+        return;
+    }
+    response.out() << json;
+}
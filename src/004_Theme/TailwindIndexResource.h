@@ -0,0 +1,43 @@
+#pragma once
+
+#include <Wt/WResource.h>
+
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Serves the Tailwind classes the editor offers as completions
+ *
+ * The index is a JSON object with two parallel arrays sorted by class name:
+ * `classes` and `details`, the declarations a class sets. It holds every utility
+ * of the compiled stylesheet, without its variant prefix, and the utilities the
+ * `@theme` tokens of input.css add (`--color-primary` gives `bg-primary`,
+ * `text-primary`, ...). The client looks prefixes up with a binary search, so
+ * completing never needs the server.
+ *
+ * Built on the first request and rebuilt when either stylesheet changes on disk.
+ * Responses carry an ETag and must be revalidated.
+ */
+class TailwindIndexResource : public Wt::WResource {
+public:
+    /**
+     * @param docRoot Document root holding static/css and static/0_stylus/tailwind
+     */
+    explicit TailwindIndexResource(std::string docRoot);
+    ~TailwindIndexResource() override;
+
+    void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+
+    /**
+     * @brief Builds the index JSON from a compiled stylesheet and a Tailwind input file
+     */
+    static std::string build(const std::string& compiledCss, const std::string& inputCss);
+
+private:
+    std::string cssPath_;
+    std::string inputPath_;
+
+    std::mutex mutex_;          ///< requests are handled outside any session
+    std::string etag_;
+    std::string json_;
+};
@@ -1,7 +1,19 @@
 #include "Theme.h"
 
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <initializer_list>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <sstream>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <Wt/DomElement.h>
 #include <Wt/WApplication.h>
@@ -23,53 +35,357 @@
 
 namespace {
 
-void addClasses(Wt::DomElement& element, std::initializer_list<const char*> classes)
+void addClasses(Wt::DomElement& element, const std::vector<const char*>& classes)
 {
     for (const char* cls : classes) {
         element.addPropertyWord(Wt::Property::Class, cls);
     }
 }
 
-std::string classesFromMessage(const char* messageId)
+void appendClasses(std::vector<const char*>& classes, std::initializer_list<const char*> more)
 {
-    if (!messageId) {
-        return {};
+    classes.insert(classes.end(), more.begin(), more.end());
+}
+
+const std::vector<const char*> TAB_BAR_CLASSES = {
+    "flex",
+    "gap-2",
+    "border-b",
+    "border-gray-200",
+    "dark:border-gray-700"
+};
+
+const std::vector<const char*> MENU_SEPARATOR_CLASSES = {
+    "my-2",
+    "border-t",
+    "border-gray-200",
+    "dark:border-gray-700"
+};
+
+const std::vector<const char*> MENU_ITEM_CLASSES = {
+    "text-sm",
+    "text-gray-700",
+    "dark:text-gray-200",
+    "hover:bg-gray-100",
+    "dark:hover:bg-gray-700",
+    "transition-colors"
+};
+
+/*
+ * Styling of one (widget type, element type, role, creating) combination.
+ * Everything that only depends on the widget's dynamic type is resolved once;
+ * the two cases that depend on the instance are flagged and finished in apply().
+ */
+struct ElementStyle {
+    std::vector<const char*> classes;
+    std::optional<Theme::ClassList> classList;
+    bool tabBarCandidate = false;   // UL whose grandparent may be a WTabWidget
+    bool menuItem = false;          // LI of a WMenuItem, depends on separator/submenu state
+};
+
+struct ElementStyleKey {
+    std::type_index type;
+    Wt::DomElementType elementType;
+    int role;
+    bool creating;
+
+    bool operator==(const ElementStyleKey& other) const
+    {
+        return type == other.type
+            && elementType == other.elementType
+            && role == other.role
+            && creating == other.creating;
+    }
+};
+
+struct ElementStyleKeyHash {
+    std::size_t operator()(const ElementStyleKey& key) const
+    {
+        std::size_t hash = key.type.hash_code();
+        hash ^= (static_cast<std::size_t>(key.elementType) << 1)
+              ^ (static_cast<std::size_t>(key.role) << 9)
+              ^ (static_cast<std::size_t>(key.creating) << 17);
+        return hash;
     }
+};
 
-    const std::string classes = Wt::WString::tr(messageId).toUTF8();
-    if (classes.size() >= 4 && classes[0] == '?' && classes[1] == '?') {
-        return {};
+ElementStyle resolveElementStyle(Wt::WWidget* widget, Wt::DomElementType elementType, int elementRole, bool creating)
+{
+    ElementStyle style;
+
+    if (dynamic_cast<Wt::WPopupWidget*>(widget)) {
+        appendClasses(style.classes, {
+            "shadow-xl",
+            "rounded-xl",
+            "border",
+            "border-gray-200",
+            "dark:border-gray-700",
+            "bg-white",
+            "dark:bg-gray-800"
+        });
     }
 
-    return classes;
+    switch (elementType) {
+    case Wt::DomElementType::BUTTON:
+        if (creating) {
+            style.classList = Theme::ClassList::Button;
+        }
+        break;
+
+    case Wt::DomElementType::DIV:
+        if (dynamic_cast<Wt::WDialog*>(widget)) {
+            appendClasses(style.classes, {
+                "bg-white",
+                "dark:bg-gray-900",
+                "rounded-2xl",
+                "shadow-2xl",
+                "border",
+                "border-gray-200",
+                "dark:border-gray-700"
+            });
+        } else if (dynamic_cast<Wt::WPanel*>(widget)) {
+            appendClasses(style.classes, {
+                "rounded-xl",
+                "border",
+                "border-gray-200",
+                "dark:border-gray-700",
+                "bg-white",
+                "dark:bg-gray-800",
+                "shadow"
+            });
+        } else if (dynamic_cast<Wt::WProgressBar*>(widget)) {
+            switch (elementRole) {
+            case Wt::MainElement:
+                appendClasses(style.classes, {
+                    "h-2",
+                    "rounded-full",
+                    "bg-gray-200",
+                    "dark:bg-gray-700",
+                    "overflow-hidden"
+                });
+                break;
+            case Wt::ProgressBarBar:
+                appendClasses(style.classes, {
+                    "h-full",
+                    "bg-blue-600",
+                    "dark:bg-blue-400",
+                    "transition-all"
+                });
+                break;
+            case Wt::ProgressBarLabel:
+                appendClasses(style.classes, {
+                    "mt-2",
+                    "text-sm",
+                    "font-medium",
+                    "text-gray-600",
+                    "dark:text-gray-300"
+                });
+                break;
+            default:
+                break;
+            }
+        }
+        break;
+
+    case Wt::DomElementType::UL:
+        if (dynamic_cast<Wt::WPopupMenu*>(widget)) {
+            appendClasses(style.classes, {
+                "bg-white",
+                "dark:bg-gray-800",
+                "rounded-lg",
+                "shadow-xl",
+                "border",
+                "border-gray-200",
+                "dark:border-gray-700",
+                "py-2"
+            });
+        } else if (dynamic_cast<Wt::WSuggestionPopup*>(widget)) {
+            appendClasses(style.classes, {
+                "bg-white",
+                "dark:bg-gray-800",
+                "rounded-lg",
+                "shadow-lg",
+                "border",
+                "border-gray-200",
+                "dark:border-gray-700",
+                "divide-y",
+                "divide-gray-200",
+                "dark:divide-gray-700"
+            });
+        } else {
+            style.tabBarCandidate = true;
+        }
+        break;
+
+    case Wt::DomElementType::LI:
+        style.menuItem = dynamic_cast<Wt::WMenuItem*>(widget) != nullptr;
+        break;
+
+    case Wt::DomElementType::INPUT:
+        if (creating) {
+            if (dynamic_cast<Wt::WCheckBox*>(widget)) {
+                style.classList = Theme::ClassList::CheckBox;
+            } else if (!dynamic_cast<Wt::WRadioButton*>(widget)) {
+                style.classList = Theme::ClassList::LineEdit;
+            }
+        }
+        break;
+
+    case Wt::DomElementType::TEXTAREA:
+        if (creating) {
+            style.classList = Theme::ClassList::LineEdit;
+        }
+        break;
+
+    case Wt::DomElementType::SELECT:
+        if (creating) {
+            style.classList = Theme::ClassList::ComboBox;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return style;
 }
 
-void addClassesFromMessage(Wt::DomElement& element, const char* messageId)
+/*
+ * Process-wide cache of resolved element styles. Themes are per session but the
+ * resolved styles only depend on widget types, so all sessions share one table.
+ */
+class ElementStyleTable
 {
-    const std::string classes = classesFromMessage(messageId);
-    if (classes.empty()) {
-        return;
+public:
+    const ElementStyle& resolve(Wt::WWidget* widget, Wt::DomElementType elementType, int elementRole, bool creating)
+    {
+        const ElementStyleKey key{std::type_index(typeid(*widget)), elementType, elementRole, creating};
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = styles_.find(key);
+            if (it != styles_.end()) {
+                return it->second;
+            }
+        }
+
+        ElementStyle style = resolveElementStyle(widget, elementType, elementRole, creating);
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        return styles_.emplace(key, std::move(style)).first->second;
     }
 
-    std::istringstream stream(classes);
-    std::string cls;
-    while (stream >> cls) {
-        element.addPropertyWord(Wt::Property::Class, cls);
+    bool isTabWidget(Wt::WWidget* widget)
+    {
+        const std::type_index type(typeid(*widget));
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = tabWidgets_.find(type);
+            if (it != tabWidgets_.end()) {
+                return it->second;
+            }
+        }
+
+        const bool tabWidget = dynamic_cast<Wt::WTabWidget*>(widget) != nullptr;
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        tabWidgets_.emplace(type, tabWidget);
+        return tabWidget;
     }
+
+private:
+    std::shared_mutex mutex_;
+    std::unordered_map<ElementStyleKey, ElementStyle, ElementStyleKeyHash> styles_;
+    std::unordered_map<std::type_index, bool> tabWidgets_;
+};
+
+ElementStyleTable& elementStyles()
+{
+    static ElementStyleTable table;
+    return table;
 }
 
-void addClassesFromMessage(Wt::WWidget* widget, const char* messageId)
+const char* CLASS_LIST_MESSAGE_IDS[] = {
+    "btn.default",
+    "lineedit.default",
+    "combobox.default",
+    "checkbox.default"
+};
+
+const std::string STYLE_SHEET_CHUNKS_PATH = "static/css/chunks/";
+// Where Server serves static/css with a year long cache lifetime, the ?v= of each URL changes with the file
+const std::string STYLE_SHEET_CHUNKS_URL = "/css/chunks/";
+
+std::mutex docRootMutex;
+std::string chunksDocRoot;     // see Theme::setDocRoot()
+
+std::string styleSheetDocRoot(const Wt::WApplication& app)
 {
-    if (!widget) {
-        return;
+    std::lock_guard<std::mutex> lock(docRootMutex);
+    if (chunksDocRoot.empty()) {
+        chunksDocRoot = app.docRoot();
     }
+    return chunksDocRoot;
+}
 
-    const std::string classes = classesFromMessage(messageId);
-    if (classes.empty()) {
-        return;
+// Chunks as last published, shared by every session of the process
+struct StyleSheetChunks {
+    std::mutex mutex;
+    bool checked = false;
+    bool available = false;
+    std::unordered_map<std::string, std::string> urls;
+};
+
+StyleSheetChunks& styleSheetChunks()
+{
+    static StyleSheetChunks chunks;
+    return chunks;
+}
+
+// Whether the prune-css target or TailwindBuilder generated the route chunks
+bool hasStyleSheetChunks(const std::string& docRoot)
+{
+    StyleSheetChunks& chunks = styleSheetChunks();
+    std::lock_guard<std::mutex> lock(chunks.mutex);
+    if (!chunks.checked) {
+        chunks.available = std::filesystem::exists(docRoot + "/" + STYLE_SHEET_CHUNKS_PATH + "core.css");
+        chunks.checked = true;
     }
+    return chunks.available;
+}
 
-    widget->addStyleClass(classes);
+/*
+ * Versioned URL of a chunk. The content is fingerprinted the first time a
+ * session asks for the chunk after it was published, the URL is then the same
+ * for every session of the process, so browsers keep the chunk across sessions
+ * and only fetch it again when it changed.
+ */
+std::string styleSheetChunkUrl(const std::string& docRoot, const std::string& chunk)
+{
+    StyleSheetChunks& chunks = styleSheetChunks();
+    std::lock_guard<std::mutex> lock(chunks.mutex);
+    auto& urls = chunks.urls;
+    auto it = urls.find(chunk);
+    if (it == urls.end()) {
+        std::ifstream file(docRoot + "/" + STYLE_SHEET_CHUNKS_PATH + chunk + ".css", std::ios::binary);
+        std::uint32_t hash = 2166136261u;
+        char c;
+        while (file.get(c)) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 16777619u;
+        }
+        char version[9];
+        std::snprintf(version, sizeof(version), "%08x", hash);
+        it = urls.emplace(chunk, STYLE_SHEET_CHUNKS_URL + chunk + ".css?v=" + version).first;
+    }
+    return it->second;
+}
+
+std::string classesFromMessage(const char* messageId)
+{
+    const std::string classes = Wt::WString::tr(messageId).toUTF8();
+    if (classes.size() >= 4 && classes[0] == '?' && classes[1] == '?') {
+        return {};
+    }
+
+    return classes;
 }
 
 }
@@ -91,10 +407,57 @@ Theme::Theme(const std::string& name)
     wApp->messageResourceBundle().use(wApp->docRoot() + "/static/0_stylus/xml/000_General/General_components");
     wApp->setHtmlClass("h-full bg-body text-on-body dark");
     wApp->setBodyClass("h-full");
+
+    // Linked rather than inlined, the bootstrap stays small and the browser caches the chunk
+    linkStyleSheetChunk("core");
 }
 
 Theme::~Theme() = default;
 
+std::atomic<unsigned> Theme::classListsVersion_{1};
+
+void Theme::invalidateClassLists()
+{
+    ++classListsVersion_;
+}
+
+const Theme::ResolvedClassList& Theme::classList(ClassList list) const
+{
+    const unsigned version = classListsVersion_.load(std::memory_order_acquire);
+    if (resolvedClassListsVersion_ != version) {
+        resolveClassLists(resolvedClassListsVersion_ != 0);
+        resolvedClassListsVersion_ = version;
+    }
+
+    return classLists_[static_cast<std::size_t>(list)];
+}
+
+void Theme::useReloadedClassLists() const
+{
+    resolveClassLists(false);
+    resolvedClassListsVersion_ = classListsVersion_.load(std::memory_order_acquire);
+}
+
+void Theme::resolveClassLists(bool reloadBundle) const
+{
+    auto* app = Wt::WApplication::instance();
+    if (reloadBundle && app) {
+        app->messageResourceBundle().refresh();
+    }
+
+    for (std::size_t i = 0; i < classLists_.size(); ++i) {
+        ResolvedClassList& resolved = classLists_[i];
+        resolved.joined = classesFromMessage(CLASS_LIST_MESSAGE_IDS[i]);
+        resolved.tokens.clear();
+
+        std::istringstream stream(resolved.joined);
+        std::string cls;
+        while (stream >> cls) {
+            resolved.tokens.push_back(cls);
+        }
+    }
+}
+
 std::string Theme::name() const
 {
     return name_;
@@ -112,15 +475,98 @@ std::vector<Wt::WLinkedCssStyleSheet> Theme::styleSheets() const
 #ifdef DEBUG
     const std::string cssPath = "static/css/tailwind.css?v=" + Wt::WRandom::generateId();
 #else
-    const std::string cssPath = "static/css/tailwind.minify.css";
+    // The core chunk is linked by the constructor, the others follow useStyleSheetChunk()
+    if (hasStyleSheetChunks(styleSheetDocRoot(*app))) {
+        return sheets;
+    }
+
+    // Output of the prune-css target, falls back to the full bundle when it was not generated
+    static const bool hasPrunedCss = std::filesystem::exists(styleSheetDocRoot(*app) + "/static/css/tailwind.pruned.css");
+    const std::string cssPath = hasPrunedCss ? "static/css/tailwind.pruned.css" : "static/css/tailwind.minify.css";
 #endif
 
     sheets.emplace_back(Wt::WLinkedCssStyleSheet(Wt::WLink(cssPath)));
     return sheets;
 }
 
+void Theme::setDocRoot(const std::string& docRoot)
+{
+    std::lock_guard<std::mutex> lock(docRootMutex);
+    chunksDocRoot = docRoot;
+}
+
+void Theme::useStyleSheetChunk(const std::string& chunk)
+{
+    auto* app = Wt::WApplication::instance();
+    if (!app) {
+        return;
+    }
+    if (auto theme = std::dynamic_pointer_cast<const Theme>(app->theme())) {
+        theme->linkStyleSheetChunk(chunk);
+    }
+}
+
+void Theme::publishStyleSheetChunks()
+{
+    StyleSheetChunks& chunks = styleSheetChunks();
+    std::lock_guard<std::mutex> lock(chunks.mutex);
+    chunks.checked = false;
+    chunks.urls.clear();
+}
+
+void Theme::updateStyleSheetChunks() const
+{
+#ifndef DEBUG
+    auto* app = Wt::WApplication::instance();
+    if (!app || !hasStyleSheetChunks(styleSheetDocRoot(*app))) {
+        return;
+    }
+
+    // A session started before there were chunks links the whole bundle, the
+    // core chunk brings it up to date
+    if (linkedChunks_.empty()) {
+        linkStyleSheetChunk("core");
+    }
+    for (auto& linked : linkedChunks_) {
+        const std::string url = styleSheetChunkUrl(styleSheetDocRoot(*app), linked.first);
+        if (url != linked.second) {
+            app->removeStyleSheet(Wt::WLink(linked.second));
+            app->useStyleSheet(Wt::WLink(url));
+            linked.second = url;
+        }
+    }
+#endif
+}
+
+void Theme::linkStyleSheetChunk(const std::string& chunk) const
+{
+#ifndef DEBUG
+    auto* app = Wt::WApplication::instance();
+    if (!app || linkedChunks_.count(chunk) || !hasStyleSheetChunks(styleSheetDocRoot(*app))) {
+        return;
+    }
+
+    const std::string url = styleSheetChunkUrl(styleSheetDocRoot(*app), chunk);
+    app->useStyleSheet(Wt::WLink(url));
+    linkedChunks_[chunk] = url;
+#else
+    (void)chunk;
+#endif
+}
+
+#ifdef BENCHMARK
+Theme::Counters& Theme::counters()
+{
+    static Counters counters;
+    return counters;
+}
+#endif
+
 void Theme::apply(Wt::WWidget* widget, Wt::WWidget* child, int widgetRole) const
 {
+#ifdef BENCHMARK
+    ++counters().widgetApply;
+#endif
     if (!widget->isThemeStyleEnabled()) {
         return;
     }
@@ -130,7 +576,9 @@ void Theme::apply(Wt::WWidget* widget, Wt::WWidget* child, int widgetRole) const
         child->addStyleClass("w-4 h-4 text-gray-500 dark:text-gray-400");
         break;
     case Wt::MenuItemCheckBox:
-        addClassesFromMessage(child, "checkbox.default");
+        if (!classList(ClassList::CheckBox).joined.empty()) {
+            child->addStyleClass(classList(ClassList::CheckBox).joined);
+        }
         break;
     case Wt::MenuItemClose:
         widget->addStyleClass("relative");
@@ -172,186 +620,38 @@ void Theme::apply(Wt::WWidget* widget, Wt::WWidget* child, int widgetRole) const
 
 void Theme::apply(Wt::WWidget* widget, Wt::DomElement& element, int elementRole) const
 {
+#ifdef BENCHMARK
+    ++counters().elementApply;
+#endif
     if (!widget->isThemeStyleEnabled()) {
         return;
     }
 
     const bool creating = element.mode() == Wt::DomElement::Mode::Create;
+    const ElementStyle& style = elementStyles().resolve(widget, element.type(), elementRole, creating);
 
-    if (auto* popup = dynamic_cast<Wt::WPopupWidget*>(widget)) {
-        addClasses(element, {
-            "shadow-xl",
-            "rounded-xl",
-            "border",
-            "border-gray-200",
-            "dark:border-gray-700",
-            "bg-white",
-            "dark:bg-gray-800"
-        });
-    }
-
-    switch (element.type()) {
-    case Wt::DomElementType::BUTTON:
-        if (creating) {
-            addClassesFromMessage(element, "btn.default");
-        }
-
-        (void)widget;
-        break;
-
-    case Wt::DomElementType::DIV:
-        if (auto* dialog = dynamic_cast<Wt::WDialog*>(widget)) {
-            addClasses(element, {
-                "bg-white",
-                "dark:bg-gray-900",
-                "rounded-2xl",
-                "shadow-2xl",
-                "border",
-                "border-gray-200",
-                "dark:border-gray-700"
-            });
-            return;
-        }
-
-        if (auto* panel = dynamic_cast<Wt::WPanel*>(widget)) {
-            addClasses(element, {
-                "rounded-xl",
-                "border",
-                "border-gray-200",
-                "dark:border-gray-700",
-                "bg-white",
-                "dark:bg-gray-800",
-                "shadow"
-            });
-            return;
-        }
-
-        if (auto* bar = dynamic_cast<Wt::WProgressBar*>(widget)) {
-            switch (elementRole) {
-            case Wt::MainElement:
-                addClasses(element, {
-                    "h-2",
-                    "rounded-full",
-                    "bg-gray-200",
-                    "dark:bg-gray-700",
-                    "overflow-hidden"
-                });
-                break;
-            case Wt::ProgressBarBar:
-                addClasses(element, {
-                    "h-full",
-                    "bg-blue-600",
-                    "dark:bg-blue-400",
-                    "transition-all"
-                });
-                break;
-            case Wt::ProgressBarLabel:
-                addClasses(element, {
-                    "mt-2",
-                    "text-sm",
-                    "font-medium",
-                    "text-gray-600",
-                    "dark:text-gray-300"
-                });
-                break;
-            default:
-                break;
-            }
-            return;
-        }
-        break;
+    addClasses(element, style.classes);
 
-    case Wt::DomElementType::UL:
-        if (dynamic_cast<Wt::WPopupMenu*>(widget)) {
-            addClasses(element, {
-                "bg-white",
-                "dark:bg-gray-800",
-                "rounded-lg",
-                "shadow-xl",
-                "border",
-                "border-gray-200",
-                "dark:border-gray-700",
-                "py-2"
-            });
-        } else if (dynamic_cast<Wt::WSuggestionPopup*>(widget)) {
-            addClasses(element, {
-                "bg-white",
-                "dark:bg-gray-800",
-                "rounded-lg",
-                "shadow-lg",
-                "border",
-                "border-gray-200",
-                "dark:border-gray-700",
-                "divide-y",
-                "divide-gray-200",
-                "dark:divide-gray-700"
-            });
-        } else {
-            auto* parent = widget ? widget->parent() : nullptr;
-            auto* grandParent = parent ? parent->parent() : nullptr;
-            if (auto* tabs = dynamic_cast<Wt::WTabWidget*>(grandParent)) {
-                (void)tabs;
-                addClasses(element, {
-                    "flex",
-                    "gap-2",
-                    "border-b",
-                    "border-gray-200",
-                    "dark:border-gray-700"
-                });
-            }
-        }
-        break;
-
-    case Wt::DomElementType::LI:
-        if (auto* item = dynamic_cast<Wt::WMenuItem*>(widget)) {
-            if (item->isSeparator()) {
-                addClasses(element, {
-                    "my-2",
-                    "border-t",
-                    "border-gray-200",
-                    "dark:border-gray-700"
-                });
-            } else {
-                addClasses(element, {
-                    "text-sm",
-                    "text-gray-700",
-                    "dark:text-gray-200",
-                    "hover:bg-gray-100",
-                    "dark:hover:bg-gray-700",
-                    "transition-colors"
-                });
-            }
-
-            if (item->menu()) {
-                addClasses(element, {"relative"});
-            }
+    if (style.classList) {
+        for (const std::string& cls : classList(*style.classList).tokens) {
+            element.addPropertyWord(Wt::Property::Class, cls);
         }
-        break;
+    }
 
-    case Wt::DomElementType::INPUT:
-        if (creating) {
-            if (dynamic_cast<Wt::WCheckBox*>(widget)) {
-                addClassesFromMessage(element, "checkbox.default");
-            } else if (!dynamic_cast<Wt::WRadioButton*>(widget)) {
-                addClassesFromMessage(element, "lineedit.default");
-            }
+    if (style.tabBarCandidate) {
+        auto* parent = widget->parent();
+        auto* grandParent = parent ? parent->parent() : nullptr;
+        if (grandParent && elementStyles().isTabWidget(grandParent)) {
+            addClasses(element, TAB_BAR_CLASSES);
         }
-        break;
-
-    case Wt::DomElementType::TEXTAREA:
-        if (creating) {
-            addClassesFromMessage(element, "lineedit.default");
-        }
-        break;
+    }
 
-    case Wt::DomElementType::SELECT:
-        if (creating) {
-            addClassesFromMessage(element, "combobox.default");
+    if (style.menuItem) {
+        auto* item = static_cast<Wt::WMenuItem*>(widget);
+        addClasses(element, item->isSeparator() ? MENU_SEPARATOR_CLASSES : MENU_ITEM_CLASSES);
+        if (item->menu()) {
+            element.addPropertyWord(Wt::Property::Class, "relative");
         }
-        break;
-
-    default:
-        break;
     }
 }
 
@@ -384,6 +684,9 @@ void Theme::applyValidationStyle(Wt::WWidget* widget,
                                  const Wt::WValidator::Result& validation,
                                  Wt::WFlags<Wt::ValidationStyleFlag> styles) const
 {
+#ifdef BENCHMARK
+    ++counters().validationStyle;
+#endif
     const bool isValid = validation.state() == Wt::ValidationState::Valid;
     const bool applyValidStyle = isValid && styles.test(Wt::ValidationStyleFlag::ValidStyle);
     const bool applyInvalidStyle = !isValid && styles.test(Wt::ValidationStyleFlag::InvalidStyle);
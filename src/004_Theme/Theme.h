@@ -1,5 +1,8 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -16,6 +19,12 @@ class WWidget;
 class Theme : public Wt::WTheme
 {
 public:
+    /*
+     * Class lists read from the General_components.xml message bundle. They are
+     * resolved once per bundle version and reused for every element.
+     */
+    enum class ClassList { Button, LineEdit, ComboBox, CheckBox };
+
     explicit Theme(const std::string& name = "tailwind");
     ~Theme() override;
 
@@ -32,6 +41,71 @@ public:
                               Wt::WFlags<Wt::ValidationStyleFlag> styles) const override;
     bool canBorderBoxElement(const Wt::DomElement& element) const override;
 
+    /*
+     * Marks General_components.xml as changed on disk. Every session reloads its
+     * message bundle and re-resolves the class lists on its next render.
+     */
+    static void invalidateClassLists();
+
+    /*
+     * Re-resolves the class lists from the bundle as the session has it loaded,
+     * for a caller that just reloaded it, so they are not reloaded a second time.
+     */
+    void useReloadedClassLists() const;
+
+    /*
+     * Links the stylesheet chunk (static/css/chunks/<chunk>.css) of a page or
+     * widget when it is first shown, under a URL versioned by its content that
+     * browsers may cache for good. The constructor links the core chunk. No-op in
+     * debug builds and when the chunks were not generated, the whole bundle is
+     * linked up front then.
+     */
+    static void useStyleSheetChunk(const std::string& chunk);
+
+    /*
+     * Tells every session the chunks on disk were replaced. Sessions started
+     * later link the new versions, a running session switches its linked
+     * chunks over with updateStyleSheetChunks().
+     */
+    static void publishStyleSheetChunks();
+
+    /*
+     * Replaces the chunks the current session links by their published versions.
+     */
+    void updateStyleSheetChunks() const;
+
+    /*
+     * Document root the stylesheet chunks are read from, for every session of
+     * the process. Server sets it from --docroot, tools that construct sessions
+     * without a server (the benchmark) set their own. Until it is set the
+     * document root of the first session asking for a chunk is used.
+     */
+    static void setDocRoot(const std::string& docRoot);
+
+#ifdef BENCHMARK
+    // Call counts read by the benchmark target (single threaded)
+    struct Counters {
+        unsigned long widgetApply = 0;
+        unsigned long elementApply = 0;
+        unsigned long validationStyle = 0;
+    };
+    static Counters& counters();
+#endif
+
 private:
+    struct ResolvedClassList {
+        std::vector<std::string> tokens;
+        std::string joined;
+    };
+
+    const ResolvedClassList& classList(ClassList list) const;
+    void resolveClassLists(bool reloadBundle) const;
+    void linkStyleSheetChunk(const std::string& chunk) const;
+
     std::string name_;
+
+    static std::atomic<unsigned> classListsVersion_;
+    mutable std::array<ResolvedClassList, 4> classLists_;
+    mutable unsigned resolvedClassListsVersion_ = 0;
+    mutable std::map<std::string, std::string> linkedChunks_;    // chunk name to the URL this session links
 };
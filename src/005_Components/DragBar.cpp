@@ -1,7 +1,8 @@
 #include "005_Components/DragBar.h"
+#include "007_State/UserPreferences.h"
 #include <Wt/WApplication.h>
+#include <algorithm>
 #include <memory>
-#include <sstream>
 
 DragBar::DragBar(Wt::WWidget* targetWidget, int initialWidth, int minWidth, int maxWidth)
     : target_widget_(targetWidget), 
@@ -17,9 +18,36 @@ DragBar::DragBar(Wt::WWidget* targetWidget, int initialWidth, int minWidth, int
     setupJavaScriptHandlers();
 }
 
+DragBar::~DragBar()
+{
+    // Removes the listeners installed by setupJavaScriptHandlers
+    if (auto app = Wt::WApplication::instance()) {
+        app->doJavaScript("if (window.StylusComponents) StylusComponents.dragBar.destroy('" + id() + "');");
+    }
+}
+
 void DragBar::onWidthChanged(int newWidth) {
-    current_width_ = newWidth;
-    width_changed_.emit(newWidth);
+    current_width_ = std::clamp(newWidth, min_width_, max_width_);
+    if (!user_id_.empty()) {
+        // Coalesced by UserPreferences, written once the user stops dragging around
+        UserPreferences::instance().set(user_id_, preference_key_, std::to_string(current_width_));
+    }
+    width_changed_.emit(current_width_);
+}
+
+void DragBar::persistWidth(const std::string& userId, const std::string& key) {
+    user_id_ = userId;
+    preference_key_ = key;
+    if (!user_id_.empty()) {
+        setWidth(UserPreferences::instance().value(user_id_, preference_key_, current_width_));
+    }
+}
+
+void DragBar::setWidth(int width) {
+    current_width_ = std::clamp(width, min_width_, max_width_);
+    if (target_widget_) {
+        target_widget_->setAttributeValue("style", "width: " + std::to_string(current_width_) + "px;");
+    }
 }
 
 void DragBar::initializeDragBar() {
@@ -29,73 +57,20 @@ void DragBar::initializeDragBar() {
     
     // Set initial width of target widget
     if (target_widget_) {
-        std::stringstream width_style;
-        width_style << "width: " << current_width_ << "px;";
-        target_widget_->setAttributeValue("style", width_style.str());
+        setWidth(current_width_);
         target_widget_->addStyleClass("flex-none");
     }
 }
 
 void DragBar::setupJavaScriptHandlers() {
-    // Generate unique IDs for the drag bar and target widget
-    std::string drag_bar_id = id();
     std::string target_id = target_widget_ ? target_widget_->id() : "";
     
     if (target_id.empty()) {
         return; // Cannot setup handlers without target widget ID
     }
 
-    // JavaScript code for drag functionality
-    std::stringstream js_stream;
-    js_stream << 
-    "var dragBar" << drag_bar_id << " = document.getElementById('" << drag_bar_id << "');\n"
-    "var targetWidget" << target_id << " = document.getElementById('" << target_id << "');\n"
-    "var isDragging" << drag_bar_id << " = false;\n"
-    "var startX" << drag_bar_id << " = 0;\n"
-    "var startWidth" << drag_bar_id << " = " << current_width_ << ";\n"
-    "\n"
-    "dragBar" << drag_bar_id << ".addEventListener('mousedown', function(e) {\n"
-    "    isDragging" << drag_bar_id << " = true;\n"
-    "    startX" << drag_bar_id << " = e.clientX;\n"
-    "    startWidth" << drag_bar_id << " = parseInt(targetWidget" << target_id << ".offsetWidth);\n"
-    "    document.body.style.cursor = 'col-resize';\n"
-    "    document.body.style.userSelect = 'none';\n"
-    "    e.preventDefault();\n"
-    "});\n"
-    "\n"
-    "document.addEventListener('mousemove', function(e) {\n"
-    "    if (!isDragging" << drag_bar_id << ") return;\n"
-    "    \n"
-    "    var deltaX = e.clientX - startX" << drag_bar_id << ";\n"
-    "    var newWidth = startWidth" << drag_bar_id << " + deltaX;\n"
-    "    \n"
-    "    // Apply constraints\n"
-    "    if (newWidth < " << min_width_ << ") newWidth = " << min_width_ << ";\n"
-    "    if (newWidth > " << max_width_ << ") newWidth = " << max_width_ << ";\n"
-    "    \n"
-    "    targetWidget" << target_id << ".style.width = newWidth + 'px';\n"
-    "    e.preventDefault();\n"
-    "});\n"
-    "\n"
-    "document.addEventListener('mouseup', function(e) {\n"
-    "    if (isDragging" << drag_bar_id << ") {\n"
-    "        isDragging" << drag_bar_id << " = false;\n"
-    "        document.body.style.cursor = '';\n"
-    "        document.body.style.userSelect = '';\n"
-    "        \n"
-    "        // Get the final width and emit signal to server\n"
-    "        var finalWidth = parseInt(targetWidget" << target_id << ".offsetWidth);\n"
-    "        Wt.emit('" << drag_bar_id << "', 'widthChanged', finalWidth);\n"
-    "    }\n"
-    "});\n"
-    "\n"
-    "// Prevent text selection during drag\n"
-    "dragBar" << drag_bar_id << ".addEventListener('selectstart', function(e) {\n"
-    "    e.preventDefault();\n"
-    "});\n";
-
-    drag_js_code_ = js_stream.str();
-    
-    // Execute the JavaScript when the widget is rendered
-    Wt::WApplication::instance()->doJavaScript(drag_js_code_);
+    // The drag logic lives in static/js/components.js, loaded once per session
+    Wt::WApplication::instance()->require("static/js/components.js", "stylus-components");
+    doJavaScript("StylusComponents.dragBar.init('" + id() + "', '" + target_id + "', "
+                 + std::to_string(min_width_) + ", " + std::to_string(max_width_) + ");");
 }
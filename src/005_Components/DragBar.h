@@ -4,12 +4,18 @@
 #include <Wt/WJavaScript.h>
 #include <Wt/WSignal.h>
 
+#include <string>
+
 /**
  * @brief A custom drag bar widget for resizing adjacent widgets
  * 
  * DragBar provides a draggable separator that can resize a target widget's width.
- * It implements JavaScript-based mouse drag functionality with proper visual feedback
- * and constraints for minimum/maximum widths.
+ * The pointer drag handling, with visual feedback and the minimum/maximum width
+ * constraints, is done client side by StylusComponents.dragBar in static/js/components.js.
+ * The server only hears about the width once a drag ends.
+ *
+ * With persistWidth() the width is kept per user in UserPreferences and is part
+ * of the first render of every later session.
  */
 class DragBar : public Wt::WContainerWidget {
 public:
@@ -25,12 +31,29 @@ public:
             int minWidth = 200, 
             int maxWidth = 800);
 
+    /**
+     * @brief Destructor - removes the drag listeners on the client
+     */
+    ~DragBar() override;
+
     /**
      * @brief Signal emitted when drag operation ends with the new width
      * @return Signal that provides the new width in pixels
      */
     Wt::Signal<int>& widthChanged() { return width_changed_; }
 
+    /**
+     * @brief Restores the width the user left the target at and stores new ones
+     * @param userId Id of the logged in user, widths of anonymous visitors (empty id) are not kept
+     * @param key Preference the width is stored under, unique per drag bar
+     */
+    void persistWidth(const std::string& userId, const std::string& key);
+
+    /**
+     * @brief Sets the width of the target widget, clamped to the allowed range
+     */
+    void setWidth(int width);
+
 private:
     /**
      * @brief Initializes the drag bar styling and behavior
@@ -52,8 +75,9 @@ private:
     int current_width_;                    ///< Current width of target widget
     int min_width_;                        ///< Minimum allowed width
     int max_width_;                        ///< Maximum allowed width
+    std::string user_id_;                  ///< User the width is stored for, empty if it is not
+    std::string preference_key_;           ///< Preference the width is stored under
     
-    std::string drag_js_code_;             ///< JavaScript code for drag functionality
     Wt::Signal<int> width_changed_;        ///< Signal emitted when width changes
     Wt::JSignal<int> js_width_changed_;    ///< JavaScript signal for width changes
 };
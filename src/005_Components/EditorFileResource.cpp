@@ -0,0 +1,90 @@
+#include "005_Components/EditorFileResource.h"
+
+#include <Wt/Http/Request.h>
+#include <Wt/Http/Response.h>
+#include <Wt/Http/ResponseContinuation.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Bytes written per continuation, the client shows large files as they arrive
+const std::size_t CHUNK_BYTES = 256 * 1024;
+
+struct Transfer {
+    std::shared_ptr<const MappedFile> file;
+    std::size_t offset;
+};
+
+}
+
+EditorFileResource::EditorFileResource()
+{
+}
+
+EditorFileResource::~EditorFileResource()
+{
+    beingDeleted();
+}
+
+void EditorFileResource::setFile(int key, std::shared_ptr<const MappedFile> file)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_[key] = std::move(file);
+}
+
+void EditorFileResource::removeFile(int key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_.erase(key);
+}
+
+std::string EditorFileResource::fileUrl(int key)
+{
+    // Keys are never reused, so the URL of a key always names the same file
+    const std::string base = url();
+    return base + (base.find('?') == std::string::npos ? "?" : "&") + "doc=" + std::to_string(key);
+}
+
+void EditorFileResource::handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response)
+{
+    Transfer transfer{nullptr, 0};
+
+    if (Wt::Http::ResponseContinuation* continuation = request.continuation()) {
+        // The rest of a transfer, from the mapping it was started with
+        transfer = Wt::cpp17::any_cast<Transfer>(continuation->data());
+    } else {
+        const std::string* key = request.getParameter("doc");
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = key ? files_.find(std::atoi(key->c_str())) : files_.end();
+            if (it != files_.end()) {
+                transfer.file = it->second;
+            }
+        }
+
+        if (!transfer.file) {
+            response.setStatus(404);
+            return;
+        }
+
+        response.setMimeType("text/plain; charset=utf-8");
+        response.addHeader("ETag", transfer.file->etag());
+        response.addHeader("Cache-Control", "no-cache");
+        if (request.headerValue("If-None-Match") == transfer.file->etag()) {
+            response.setStatus(304);
+            return;
+        }
+        response.setContentLength(transfer.file->size());
+    }
+
+    const std::string_view data = transfer.file->data();
+    const std::size_t end = std::min(transfer.offset + CHUNK_BYTES, data.size());
+    response.out().write(data.data() + transfer.offset, end - transfer.offset);
+
+    if (end < data.size()) {
+        Wt::Http::ResponseContinuation* next = response.createContinuation();
+        next->setData(Transfer{transfer.file, end});
+    }
+}
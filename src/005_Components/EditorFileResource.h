@@ -0,0 +1,50 @@
+#pragma once
+
+#include "005_Components/MappedFile.h"
+
+#include <Wt/WResource.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Serves the files loaded in a MonacoEditor to the browser
+ *
+ * Each open tab is served under its own key, so tabs loading at the same time
+ * never get each other's file.
+ * Serves the same mapping the editor's buffer was loaded from, so the file is
+ * read once for both. Responses carry an ETag from the file's modification time
+ * and size and must be revalidated, so a reload of an unchanged file is a 304.
+ * The body is written in chunks through response continuations, so a large file
+ * never sits in a response buffer as a whole and reaches the client progressively.
+ */
+class EditorFileResource : public Wt::WResource {
+public:
+    EditorFileResource();
+    ~EditorFileResource() override;
+
+    /**
+     * @brief Sets the file served under a key
+     * @param key Key of the file, the generation of the editor's document
+     * @param file Mapped file, nullptr serves a 404
+     */
+    void setFile(int key, std::shared_ptr<const MappedFile> file);
+
+    /**
+     * @brief Stops serving the file under a key
+     */
+    void removeFile(int key);
+
+    /**
+     * @brief URL of the file served under a key
+     */
+    std::string fileUrl(int key);
+
+    void handleRequest(const Wt::Http::Request& request, Wt::Http::Response& response) override;
+
+private:
+    std::mutex mutex_;                          ///< requests are handled outside the session lock
+    std::map<int, std::shared_ptr<const MappedFile>> files_;
+};
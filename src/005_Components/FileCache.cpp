@@ -0,0 +1,65 @@
+#include "005_Components/FileCache.h"
+
+FileCache& FileCache::instance()
+{
+    static FileCache cache;
+    return cache;
+}
+
+std::shared_ptr<const MappedFile> FileCache::get(const std::string& path)
+{
+    // MappedFile::open() fstats the file on every lookup and hands out the live
+    // content only while the size and mtime are unchanged, a cached entry of a
+    // changed file is dropped below
+    auto file = MappedFile::open(path);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(path);
+    if (it != index_.end()) {
+        if (it->second->file == file) {
+            ++stats_.hits;
+            entries_.splice(entries_.begin(), entries_, it->second);
+            return file;
+        }
+        erase(it->second);
+    }
+
+    ++stats_.misses;
+    if (!file || file->size() > capacity_) {
+        return file;
+    }
+    entries_.push_front(Entry{path, file});
+    index_[path] = entries_.begin();
+    stats_.bytes += file->size();
+    evict();
+    return file;
+}
+
+void FileCache::setCapacity(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = bytes;
+    evict();
+}
+
+FileCache::Stats FileCache::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+void FileCache::erase(std::list<Entry>::iterator entry)
+{
+    stats_.bytes -= entry->file->size();
+    index_.erase(entry->path);
+    entries_.erase(entry);
+}
+
+void FileCache::evict()
+{
+    while (stats_.bytes > capacity_ && !entries_.empty()) {
+        erase(std::prev(entries_.end()));
+    }
+}
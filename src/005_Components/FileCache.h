@@ -0,0 +1,70 @@
+#pragma once
+
+#include "005_Components/MappedFile.h"
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Process-wide LRU cache of the files opened in editors
+ *
+ * Keeps the content of recently opened files alive after every editor closed
+ * them, so switching back to a file or opening it in another session does not
+ * go to the disk again. Entries are keyed by path and checked against the file's
+ * modification time and size on every lookup, a changed file is opened again.
+ * The least recently used files are dropped once their total size exceeds the
+ * capacity.
+ */
+class FileCache {
+public:
+    /**
+     * @brief The cache shared by all sessions
+     */
+    static FileCache& instance();
+
+    /**
+     * @brief Returns the current version of a file, mapping it if needed
+     * @param path Path of the file
+     * @return The mapping, or nullptr if the file cannot be opened
+     */
+    std::shared_ptr<const MappedFile> get(const std::string& path);
+
+    /**
+     * @brief Sets the total size of the cached files, 64 MB by default
+     * @param bytes Capacity in bytes, larger files are never cached
+     */
+    void setCapacity(std::size_t bytes);
+
+    struct Stats {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t entries = 0;
+        std::size_t bytes = 0;
+    };
+
+    /**
+     * @brief Counters since the start of the process
+     */
+    Stats stats();
+
+private:
+    FileCache() = default;
+
+    struct Entry {
+        std::string path;
+        std::shared_ptr<const MappedFile> file;
+    };
+
+    void erase(std::list<Entry>::iterator entry);
+    void evict();
+
+    std::mutex mutex_;
+    std::list<Entry> entries_;      ///< most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    std::size_t capacity_ = 64 * 1024 * 1024;
+    Stats stats_;
+};
@@ -0,0 +1,106 @@
+#include "005_Components/MappedFile.h"
+
+#include <Wt/WLogger.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+// Larger files are mapped, see the class comment
+const std::size_t MAP_THRESHOLD = 1024 * 1024;
+
+// Files currently open, so sessions opening the same file version share one
+std::mutex registry_mutex;
+std::unordered_map<std::string, std::weak_ptr<const MappedFile>> registry;
+
+std::string makeEtag(const struct stat& st)
+{
+    std::ostringstream etag;
+    etag << '"' << std::hex << st.st_mtim.tv_sec << '.' << st.st_mtim.tv_nsec << '-' << st.st_size << '"';
+    return etag.str();
+}
+
+}
+
+std::shared_ptr<const MappedFile> MappedFile::open(const std::string& path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        Wt::log("error") << "Failed to open file: " << path << ": " << std::strerror(errno);
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        Wt::log("error") << "Failed to stat file: " << path;
+        ::close(fd);
+        return nullptr;
+    }
+
+    const std::string etag = makeEtag(st);
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto it = registry.find(path);
+    if (it != registry.end()) {
+        if (auto shared = it->second.lock()) {
+            if (shared->etag() == etag) {
+                ::close(fd);
+                return shared;
+            }
+        }
+    }
+
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->size_ = static_cast<std::size_t>(st.st_size);
+    file->etag_ = etag;
+
+    if (file->size_ > MAP_THRESHOLD) {
+        void* data = mmap(nullptr, file->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            Wt::log("error") << "Failed to map file: " << path << ": " << std::strerror(errno);
+            ::close(fd);
+            return nullptr;
+        }
+        madvise(data, file->size_, MADV_SEQUENTIAL);
+        file->data_ = static_cast<const char*>(data);
+        file->mapped_ = true;
+    } else if (file->size_ > 0) {
+        // A file truncated while it is read just ends early
+        file->content_.resize(file->size_);
+        std::size_t read = 0;
+        while (read < file->size_) {
+            const ssize_t n = ::pread(fd, &file->content_[read], file->size_ - read, static_cast<off_t>(read));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            read += static_cast<std::size_t>(n);
+        }
+        file->content_.resize(read);
+        file->size_ = read;
+        file->data_ = file->content_.data();
+    }
+    ::close(fd);
+
+    for (auto entry = registry.begin(); entry != registry.end();) {
+        entry = entry->second.expired() ? registry.erase(entry) : std::next(entry);
+    }
+    registry[path] = file;
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+    if (mapped_) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
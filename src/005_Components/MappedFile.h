@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Read-only content of a whole file, memory mapped if it is large
+ *
+ * Files up to 1 MB, which is every template, stylesheet and script edited in
+ * Stylus, are read into memory: a mapping of a file that something other than
+ * FileWriter truncates in place (an external editor, a build, `> file`) raises
+ * SIGBUS on the next read of a page past the new end, which would take the
+ * server down. Larger files are mapped, their content stays valid as long as
+ * the file is replaced by renaming a new file over it, which is how FileWriter
+ * writes.
+ *
+ * Opening a file that is already open with the same modification time and size
+ * returns the existing content, so all sessions editing a file share it.
+ */
+class MappedFile {
+public:
+    /**
+     * @brief Maps a file, or returns the live mapping of the same version of it
+     * @param path Path of the file
+     * @return The mapping, or nullptr if the file cannot be opened
+     */
+    static std::shared_ptr<const MappedFile> open(const std::string& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Content of the file
+     */
+    std::string_view data() const { return std::string_view(data_, size_); }
+
+    /**
+     * @brief Size of the file in bytes
+     */
+    std::size_t size() const { return size_; }
+
+    /**
+     * @brief Quoted entity tag derived from the modification time and size
+     */
+    const std::string& etag() const { return etag_; }
+
+private:
+    MappedFile() = default;
+
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::string etag_;
+    std::string content_;   ///< the file's bytes when it is read rather than mapped
+    bool mapped_ = false;
+};
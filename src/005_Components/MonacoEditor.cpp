@@ -1,82 +1,80 @@
 #include "005_Components/MonacoEditor.h"
+#include "005_Components/FileCache.h"
+#include "009_Services/FileWriter.h"
+#include "009_Services/XmlValidator.h"
 #include <Wt/WApplication.h>
-#include <Wt/WRandom.h>
+#include <Wt/Core/observing_ptr.hpp>
+#include <Wt/WServer.h>
 #include <Wt/WLogger.h>
+#include <Wt/WText.h>
+#include <Wt/Json/Array.h>
+#include <Wt/Json/Parser.h>
+#include <Wt/Json/Value.h>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 
+namespace {
+
+// Vendored by scripts/libs/monaco/download.sh, served immutable under /vendor by the Server
+const std::string MONACO_VERSION = "0.34.1";
+const std::string MONACO_VS_URL = "/vendor/monaco-editor/" + MONACO_VERSION + "/min/vs";
+// Where the Server's /vendor resource finds the loader, relative to the document root
+const std::string MONACO_LOADER_PATH = "/static/vendor/monaco-editor/" + MONACO_VERSION + "/min/vs/loader.js";
+
+// Deployed by the Server, see TailwindIndexResource
+const std::string TAILWIND_INDEX_URL = "/tailwind-index.json";
+
+// Files above this size are streamed into the editor in chunks, see setEditorText()
+const std::size_t LARGE_FILE_BYTES = 1024 * 1024;
+
+}
+
 MonacoEditor::MonacoEditor(std::string language)
-    : js_signal_text_changed_(this, "editorTextChanged"),
-      current_text_(""),
-      unsaved_text_("")
+    : file_resource_(std::make_shared<EditorFileResource>()),
+      session_id_(wApp->sessionId()),
+      js_signal_delta_(this, "editorDelta"),
+      js_signal_checksum_(this, "editorChecksum"),
+      js_signal_resync_(this, "editorResync"),
+      js_signal_ready_(this, "editorReady"),
+      js_signal_activated_(this, "editorActivated"),
+      js_signal_closed_(this, "editorClosed")
 {
     setLayoutSizeAware(true);
     setMinimumSize(Wt::WLength(1, Wt::LengthUnit::Pixel), Wt::WLength(1, Wt::LengthUnit::Pixel));
-    wApp->require(wApp->docRoot() + "/static/stylus/monaco-edditor.js", "monaco-editor");
+    // Monaco is not part of the repository, without it the editor would silently never load
+    const bool monaco_installed = std::filesystem::is_regular_file(wApp->docRoot() + MONACO_LOADER_PATH);
+    if (!monaco_installed) {
+        Wt::log("error") << "MonacoEditor: " << MONACO_LOADER_PATH << " is missing, run scripts/libs/monaco/download.sh";
+        addNew<Wt::WText>("The Monaco editor " + MONACO_VERSION + " is not installed. Run scripts/libs/monaco/download.sh on the server.")
+            ->setStyleClass("p-4 text-sm text-red-600");
+    } else {
+        // Loaded once per session, with the first editor
+        wApp->require(MONACO_VS_URL + "/loader.js", "monaco-loader");
+    }
+    wApp->require("static/js/components.js", "stylus-components");
 
     // setMaximumSize(Wt::WLength::Auto, Wt::WLength(100, Wt::LengthUnit::ViewportHeight));
     // setStyleClass("h-fill");
 
-    js_signal_text_changed_.connect(this, &MonacoEditor::editorTextChanged);
-    doJavaScript(R"(require.config({ paths: { 'vs': 'https://unpkg.com/monaco-editor@0.34.1/min/vs' } });)");
-    editor_js_var_name_ = language + Wt::WRandom::generateId() + "_editor";
-    
+    js_signal_delta_.connect(this, &MonacoEditor::editorDelta);
+    js_signal_checksum_.connect(this, &MonacoEditor::editorChecksum);
+    js_signal_resync_.connect(this, &MonacoEditor::editorResync);
+    js_signal_ready_.connect(this, &MonacoEditor::editorReady);
+    js_signal_activated_.connect(this, &MonacoEditor::editorActivated);
+    js_signal_closed_.connect(this, &MonacoEditor::editorClosed);
+
     resize(Wt::WLength::Auto, Wt::WLength::Auto);
     // Check for dark theme globally
     bool isDarkMode = wApp->htmlClass().find("dark") != std::string::npos;
-    
-    std::string initializer =
-        R"(
-        require(['vs/editor/editor.main'], function () {
-            window.)" + editor_js_var_name_ + R"(_current_text = `)" + current_text_ + R"(`;
-            window.)" + editor_js_var_name_ + R"( = monaco.editor.create(document.getElementById(')" + id() + R"('), {
-                language: ')" + language + R"(',
-                theme: )" + (isDarkMode ? "'vs-dark'" : "'vs-light'") + R"(,
-                wordWrap: 'on',
-                lineNumbers: 'on',
-                tabSize: 4,
-                insertSpaces: false,
-                detectIndentation: false,
-                trimAutoWhitespace: false,
-                lineEnding: '\n',
-                minimap: { enabled: false },
-                automaticLayout: true,
-                scrollbar: {
-                    vertical: 'auto',    // Show vertical scrollbar only if needed
-                    horizontal: 'auto',  // Show horizontal scrollbar only if needed
-                    handleMouseWheel: true
-                },
-                scrollBeyondLastLine: false
-            });
-
-            window.)" + editor_js_var_name_ + R"(.onDidChangeModelContent(function (event) {
-                if (window.)" + editor_js_var_name_ + R"(_current_text !== window.)" + editor_js_var_name_ + R"(.getValue()) {
-                    window.)" + editor_js_var_name_ + R"(_current_text = window.)" + editor_js_var_name_ + R"(.getValue();
-                    Wt.emit(')" + id() + R"(', 'editorTextChanged', window.)" + editor_js_var_name_ + R"(.getValue());
-                }
-            });
-            
-            window.)" + editor_js_var_name_ + R"(.getDomNode().addEventListener('keydown', function(e) {
-                if ((e.ctrlKey || e.metaKey)) {
-                    if (e.key === 's') {
-                        e.preventDefault();
-                    }
-                }
-                if (e.altKey && e.key === 'x') {
-                    const currentMinimap = window.)" + editor_js_var_name_ + R"(.getOptions().get(monaco.editor.EditorOption.minimap).enabled;
-                    window.)" + editor_js_var_name_ + R"(.updateOptions({ minimap: { enabled: !currentMinimap } });
-                }
-                if (e.altKey && e.key === 'z') {
-                    e.preventDefault();
-                    const currentWordWrap = window.)" + editor_js_var_name_ + R"(.getOptions().get(monaco.editor.EditorOption.wordWrap);
-                    const newWordWrap = currentWordWrap === 'off' ? 'on' : 'off';
-                    window.)" + editor_js_var_name_ + R"(.updateOptions({ wordWrap: newWordWrap });
-                }
-            });
-        });
-    )";
 
-    setJavaScriptMember("something", initializer);
+    // Runs once the widget is rendered, see static/js/components.js for the editor itself.
+    // Without Monaco the other calls wait for an editor that never comes, which is harmless.
+    if (monaco_installed) callClient("init", ", " + Wt::WWebWidget::jsStringLiteral(MONACO_VS_URL)
+        + ", { language: " + Wt::WWebWidget::jsStringLiteral(language)
+        + ", dark: " + (isDarkMode ? "true" : "false")
+        + ", completions: " + Wt::WWebWidget::jsStringLiteral(TAILWIND_INDEX_URL) + " }");
 
     keyWentDown().connect([=](Wt::WKeyEvent e){ 
         Wt::WApplication::instance()->globalKeyWentDown().emit(e); // Emit the global key event
@@ -85,11 +83,37 @@ MonacoEditor::MonacoEditor(std::string language)
             if (e.key() == Wt::Key::S)
             {
                 if(unsavedChanges()){
-                    save_file_signal_.emit(unsaved_text_);
+                    // Materializing the text is only worth it for someone listening
+                    if (save_file_signal_.isConnected()) {
+                        save_file_signal_.emit(getUnsavedText());
+                    }
+                    saveFile();
                 }
             }
         } 
     });
+
+    // Validations and saves come back through server push. Wt counts these
+    // calls, the destructor gives this one back.
+    wApp->enableUpdates(true);
+}
+
+MonacoEditor::~MonacoEditor()
+{
+    for (const auto& entry : documents_) {
+        XmlValidator::instance().cancel(validationKey(entry.first));
+    }
+
+    // Disposes the editor and its listeners on the client
+    if (auto app = Wt::WApplication::instance()) {
+        app->doJavaScript("if (window.StylusComponents) StylusComponents.monacoEditor.destroy('" + id() + "');");
+        app->enableUpdates(false);
+    }
+}
+
+void MonacoEditor::callClient(const std::string& method, const std::string& arguments)
+{
+    doJavaScript("StylusComponents.monacoEditor." + method + "('" + id() + "'" + arguments + ");");
 }
 
 void MonacoEditor::layoutSizeChanged(int width, int height)
@@ -101,86 +125,287 @@ void MonacoEditor::layoutSizeChanged(int width, int height)
 }
 
 
-void MonacoEditor::editorTextChanged(std::string text)
+MonacoEditor::Document* MonacoEditor::activeDocument()
+{
+    auto it = documents_.find(active_);
+    return it != documents_.end() ? &it->second : nullptr;
+}
+
+void MonacoEditor::removeDocument(int generation)
+{
+    documents_.erase(generation);
+    file_resource_->removeFile(generation);
+    XmlValidator::instance().cancel(validationKey(generation));
+    // The client shows the last remaining tab, the one loaded most recently
+    if (generation == active_) {
+        active_ = documents_.empty() ? 0 : documents_.rbegin()->first;
+        file_activated_.emit(activeFile());
+    }
+}
+
+void MonacoEditor::editorDelta(int generation, int seq, std::string changes)
 {
-    unsaved_text_ = text;
+    auto it = documents_.find(generation);
+    if (it == documents_.end() || it->second.resyncing) {
+        return;
+    }
+    Document& document = it->second;
+    if (seq != document.seq + 1) {
+        Wt::log("error") << "MonacoEditor: expected delta " << document.seq + 1 << ", got " << seq << ", resyncing";
+        requestResync(generation, document);
+        return;
+    }
+
+    try {
+        Wt::Json::Value value;
+        Wt::Json::parse(changes, value);
+        const Wt::Json::Array& ranges = value;
+        for (const Wt::Json::Value& range : ranges) {
+            const Wt::Json::Array& change = range;
+            const int offset = change.at(0);
+            const int length = change.at(1);
+            const Wt::WString& text = change.at(2);
+            // The client's ranges are not trusted, one outside the text means the copies diverged
+            if (offset < 0 || length < 0
+                || static_cast<std::size_t>(offset) + static_cast<std::size_t>(length) > document.unsaved.units()
+                || !document.unsaved.replace(offset, length, text.toUTF8())) {
+                Wt::log("error") << "MonacoEditor: delta " << seq << " has a range outside the text, resyncing";
+                requestResync(generation, document);
+                return;
+            }
+        }
+    } catch (const std::exception& e) {
+        Wt::log("error") << "MonacoEditor: invalid delta " << seq << ": " << e.what();
+        requestResync(generation, document);
+        return;
+    }
+
+    document.seq = seq;
+    validate(generation, document);
     available_save_.emit();
 }
 
-void MonacoEditor::textSaved()
+void MonacoEditor::editorChecksum(int generation, int seq, std::string checksum)
 {
-    current_text_ = unsaved_text_;
+    auto it = documents_.find(generation);
+    if (it == documents_.end() || it->second.resyncing || seq != it->second.seq) {
+        return;
+    }
+    if (std::strtoul(checksum.c_str(), nullptr, 16) != it->second.unsaved.checksum()) {
+        Wt::log("error") << "MonacoEditor: checksum mismatch at delta " << seq << ", resyncing";
+        requestResync(generation, it->second);
+    }
+}
+
+void MonacoEditor::editorResync(int generation, int seq, std::string text)
+{
+    auto it = documents_.find(generation);
+    if (it == documents_.end()) {
+        return;
+    }
+    it->second.unsaved.reset(std::move(text));
+    it->second.seq = seq;
+    it->second.resyncing = false;
+    validate(generation, it->second);
     available_save_.emit();
 }
 
+void MonacoEditor::requestResync(int generation, Document& document)
+{
+    if (document.resyncing) {
+        return;
+    }
+    document.resyncing = true;
+    callClient("resync", ", " + std::to_string(generation));
+}
+
+std::string MonacoEditor::validationKey(int generation) const
+{
+    return session_id_ + "/" + id() + "/" + std::to_string(generation);
+}
+
+void MonacoEditor::validate(int generation, const Document& document)
+{
+    const std::string& path = document.path;
+    if (path.size() < 4 || path.compare(path.size() - 4, 4, ".xml") != 0) {
+        return;
+    }
+
+    // The snapshot shares the buffer's memory instead of copying the text, the
+    // check runs on the validator thread and comes back through server push
+    const std::string session_id = session_id_;
+    Wt::Core::observing_ptr<MonacoEditor> self(this);
+
+    PieceTable::Snapshot snapshot = document.unsaved.snapshot();
+    XmlValidator::instance().validate(validationKey(generation), std::move(snapshot.parts), std::move(snapshot.owner),
+        [=](std::vector<XmlValidator::Diagnostic> diagnostics) {
+            if (auto server = Wt::WServer::instance()) {
+                server->post(session_id, [=]() {
+                    if (self) {
+                        self->showDiagnostics(generation, diagnostics);
+                        wApp->triggerUpdate();
+                    }
+                });
+            }
+        });
+}
+
+void MonacoEditor::showDiagnostics(int generation, const std::vector<XmlValidator::Diagnostic>& diagnostics)
+{
+    if (!documents_.count(generation)) {
+        return;
+    }
+
+    Wt::WStringStream markers;
+    markers << "[";
+    for (std::size_t i = 0; i < diagnostics.size(); ++i) {
+        const XmlValidator::Diagnostic& diagnostic = diagnostics[i];
+        markers << (i ? "," : "") << "[" << diagnostic.line << "," << diagnostic.column << ","
+                << diagnostic.end_line << "," << diagnostic.end_column << ","
+                << (diagnostic.error ? "true" : "false") << ","
+                << Wt::WWebWidget::jsStringLiteral(diagnostic.message) << "]";
+    }
+    markers << "]";
+    callClient("setMarkers", ", " + std::to_string(generation) + ", " + markers.str());
+}
+
+void MonacoEditor::editorActivated(int generation)
+{
+    if (generation == active_ || !documents_.count(generation)) {
+        return;
+    }
+    active_ = generation;
+    file_activated_.emit(activeFile());
+    available_save_.emit();
+}
+
+void MonacoEditor::editorClosed(int generation)
+{
+    if (documents_.count(generation)) {
+        removeDocument(generation);
+        available_save_.emit();
+    }
+}
+
+void MonacoEditor::editorReady(int milliseconds, bool cached)
+{
+    Wt::log("info") << "MonacoEditor: ready in " << milliseconds << " ms ("
+                    << (cached ? "editor already loaded" : "first editor of the session") << ")";
+}
+
+void MonacoEditor::textSaved()
+{
+    if (Document* document = activeDocument()) {
+        document->saved_checksum = document->unsaved.checksum();
+        document->saved_size = document->unsaved.size();
+        available_save_.emit();
+    }
+}
+
+std::string MonacoEditor::getUnsavedText()
+{
+    Document* document = activeDocument();
+    return document ? document->unsaved.text() : std::string();
+}
+
+std::string MonacoEditor::activeFile() const
+{
+    auto it = documents_.find(active_);
+    return it != documents_.end() ? it->second.path : std::string();
+}
+
 void MonacoEditor::setReadOnly(bool readOnly) { 
-    doJavaScript("setTimeout(function() { if(window." + editor_js_var_name_ + ") window." + editor_js_var_name_ + ".updateOptions({ readOnly: " + std::to_string(readOnly) + " }); }, 200);");
+    callClient("setReadOnly", std::string(", ") + (readOnly ? "true" : "false"));
 }
 
 bool MonacoEditor::unsavedChanges()
 {
-    if (current_text_.compare(unsaved_text_) == 0)
-    {
+    // Called after every delta batch. A different size answers without reading
+    // the text, the checksum is only computed once per change and then cached.
+    Document* document = activeDocument();
+    if (!document) {
         return false;
     }
-    return true;
+    return document->unsaved.size() != document->saved_size
+        || document->unsaved.checksum() != document->saved_checksum;
 }
 
 void MonacoEditor::setEditorText(std::string resourcePath)
 {
+    // A reload replaces the tab, deltas made against the old text are dropped and
+    // its pending validation is cancelled
+    for (auto it = documents_.begin(); it != documents_.end(); ++it) {
+        if (it->second.path == resourcePath) {
+            removeDocument(it->first);
+            break;
+        }
+    }
+
+    auto file = FileCache::instance().get(resourcePath);
+    const int generation = ++sync_generation_;
+    file_resource_->setFile(generation, file);
+    const bool large = file && file->size() > LARGE_FILE_BYTES;
+    callClient("open", ", " + Wt::WWebWidget::jsStringLiteral(file_resource_->fileUrl(generation))
+        + ", " + std::to_string(generation) + ", " + Wt::WWebWidget::jsStringLiteral(resourcePath)
+        + ", " + (large ? "true" : "false"));
+
+    Document& document = documents_[generation];
+    document.path = resourcePath;
+    if (file) {
+        document.unsaved.reset(file->data(), file);
+    } else {
+        document.unsaved.reset(std::string());
+    }
+    document.saved_checksum = document.unsaved.checksum();
+    document.saved_size = document.unsaved.size();
+    validate(generation, document);
+    active_ = generation;
+    file_activated_.emit(resourcePath);
     resetLayout();
-    auto resourcePathUrl = resourcePath + "?v=" + Wt::WRandom::generateId();
-    doJavaScript(
-        R"(
-            setTimeout(function() {
-                if(!window.)" + editor_js_var_name_ + R"() {
-                    setTimeout(function() {
-                        console.log("Setting editor text to: )" + resourcePathUrl + R"(");
-                        if (window.)" + editor_js_var_name_ + R"() {
-                            fetch(')" + resourcePathUrl + R"(')
-                            .then(response => response.text())
-                            .then(css => {
-                                window.)" + editor_js_var_name_ + R"(_current_text = css;
-                                window.)" + editor_js_var_name_ + R"(.setValue(css);
-                            });
-                        } else {
-                            console.error("Editor instance is stil l not initialized.");
-                        }
-                    }, 2000);
-                    return;
-                }
-                console.log("Setting editor text to: )" + resourcePathUrl + R"(");
-                fetch(')" + resourcePathUrl + R"(')
-                    .then(response => response.text())
-                    .then(css => {
-                        window.)" + editor_js_var_name_ + R"(_current_text = css;
-                        window.)" + editor_js_var_name_ + R"(.setValue(css);
-                    });
-            }, 10); // Delay to ensure the editor is ready
-        )");
-    current_text_ = getFileText(resourcePath);
-    unsaved_text_ = current_text_;
-    selected_file_path_ = resourcePath;
-    resetLayout();
+}
+
+void MonacoEditor::openFile(const std::string& path)
+{
+    for (const auto& entry : documents_) {
+        if (entry.second.path == path) {
+            if (entry.first != active_) {
+                active_ = entry.first;
+                callClient("activate", ", " + std::to_string(entry.first));
+                file_activated_.emit(path);
+            }
+            return;
+        }
+    }
+    setEditorText(path);
+}
+
+void MonacoEditor::closeFile(const std::string& path)
+{
+    for (const auto& entry : documents_) {
+        if (entry.second.path == path) {
+            const int generation = entry.first;
+            callClient("close", ", " + std::to_string(generation));
+            removeDocument(generation);
+            return;
+        }
+    }
+}
+
+void MonacoEditor::setSyncWindow(int idleMs, int maxLatencyMs)
+{
+    callClient("setSyncWindow", ", " + std::to_string(idleMs) + ", " + std::to_string(maxLatencyMs));
 }
 
 void MonacoEditor::resetLayout()
 {
-    doJavaScript("setTimeout(function() { window." + editor_js_var_name_ + ".layout() }, 200);");
+    callClient("layout");
 }
 
 void MonacoEditor::setDarkTheme(bool dark)
 {
-    wApp->doJavaScript(R"(
-        (function() {
-            var interval = setInterval(function() {
-                if (window.monaco) {
-                    clearInterval(interval);
-                    monaco.editor.setTheme(')" + std::string(dark ? "vs-dark" : "vs-light") + R"(');
-                }
-            }, 100);
-        })();
-    )");
+    // Editors created later read the theme from the html class
+    wApp->doJavaScript(std::string("if (window.StylusComponents) StylusComponents.monacoEditor.setDarkTheme(")
+        + (dark ? "true" : "false") + ");");
 }
 
 
@@ -195,49 +420,74 @@ std::string MonacoEditor::getFileText(std::string filePath)
 
     std::string file_content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
     file.close();
-    Wt::WString file_content_wt = Wt::WString::fromUTF8(file_content);
     return file_content;
 }
 
 void MonacoEditor::saveFile()
 {
     // Save the unsaved text to the file system
-    if (unsaved_text_.empty())
+    Document* document = activeDocument();
+    // An emptied file is saved like any other change, only unchanged text is skipped
+    if (!document || !unsavedChanges())
     {
         Wt::log("info") << "No unsaved text to save.";
         return;
     }
-    std::ofstream file(selected_file_path_);
-    if (!file.is_open())
+
+    // The writer replaces the file by renaming, which also keeps the mapping of
+    // the loaded text valid. What is saved is what the buffer holds right now,
+    // edits made while the write runs stay unsaved. The snapshot copies nothing,
+    // the text is written straight from the mapping and the inserted blocks.
+    const std::string path = document->path;
+    const std::uint32_t checksum = document->unsaved.checksum();
+    const std::size_t size = document->unsaved.size();
+    const std::string session_id = wApp->sessionId();
+    Wt::Core::observing_ptr<MonacoEditor> self(this);
+
+    PieceTable::Snapshot snapshot = document->unsaved.snapshot();
+    FileWriter::instance().write(path, std::move(snapshot.parts), std::move(snapshot.owner), [=](const std::string& error) {
+        if (auto server = Wt::WServer::instance()) {
+            server->post(session_id, [=]() {
+                if (self) {
+                    self->fileSaved(path, checksum, size, error);
+                    wApp->triggerUpdate();
+                }
+            });
+        }
+    }, save_sync_);
+}
+
+void MonacoEditor::setSaveSync(bool sync)
+{
+    save_sync_ = sync;
+}
+
+void MonacoEditor::fileSaved(const std::string& path, std::uint32_t checksum, std::size_t size, const std::string& error)
+{
+    if (!error.empty())
     {
-        Wt::log("error") << "Failed to open file for writing: " << selected_file_path_;
+        save_finished_.emit(false);
         return;
     }
-    file << unsaved_text_;
-    file.close();
-    Wt::log("info") << "File path: " << selected_file_path_ << " saved successfully.";
+    // The tab may have been switched or closed while the write ran
+    for (auto& entry : documents_)
+    {
+        if (entry.second.path == path)
+        {
+            entry.second.saved_checksum = checksum;
+            entry.second.saved_size = size;
+            available_save_.emit();
+        }
+    }
+    save_finished_.emit(true);
 }
 
 void MonacoEditor::toggleLineWrap()
 {
-    doJavaScript(R"(
-        setTimeout(function() {
-            if (window.)" + editor_js_var_name_ + R"() {
-                const currentWordWrap = window.)" + editor_js_var_name_ + R"(.getOptions().get(monaco.editor.EditorOption.wordWrap);
-                const newWordWrap = currentWordWrap === 'off' ? 'on' : 'off';
-                window.)" + editor_js_var_name_ + R"(.updateOptions({ wordWrap: newWordWrap });
-            }
-        }, 20);
-    )");
+    callClient("toggleLineWrap");
 }
+
 void MonacoEditor::toggleMinimap()
 {
-    doJavaScript(R"(
-        setTimeout(function() {
-            if (window.)" + editor_js_var_name_ + R"() {
-                const currentMinimap = window.)" + editor_js_var_name_ + R"(.getOptions().get(monaco.editor.EditorOption.minimap).enabled;
-                window.)" + editor_js_var_name_ + R"(.updateOptions({ minimap: { enabled: !currentMinimap } });
-            }
-        }, 20);
-    )");
+    callClient("toggleMinimap");
 }
@@ -1,16 +1,38 @@
 #pragma once
 
+#include "005_Components/EditorFileResource.h"
+#include "005_Components/PieceTable.h"
+#include "009_Services/XmlValidator.h"
+
 #include <Wt/WContainerWidget.h>
 #include <Wt/WJavaScript.h>
 #include <Wt/WStringStream.h>
 #include <Wt/WSignal.h>
 
+#include <cstdint>
+#include <map>
+#include <memory>
+
 /**
  * @brief A Monaco code editor widget integrated with Wt
  * 
  * MonacoEditor provides a rich code editor with syntax highlighting, 
  * customizable themes, and various editor features like line wrapping,
  * minimap toggle, and file operations.
+ *
+ * Edits are synced as Monaco change ranges tagged with a sequence number and
+ * applied to a piece table, so a keystroke costs a few bytes regardless of the
+ * file size. The client periodically sends a checksum of its text, on a sequence
+ * gap or a mismatch the server asks for the full text once.
+ *
+ * Several files can be open at once, each in a tab with its own Monaco model and
+ * its own synced buffer. Tabs are switched in the browser without a round trip,
+ * the server is told which one is active afterwards. Files are loaded through
+ * the process-wide FileCache.
+ *
+ * XML files are checked by the XmlValidator in the background as edits arrive,
+ * its diagnostics are shown as markers in the editor. Tailwind classes are
+ * completed in the browser from the index of TailwindIndexResource.
  */
 class MonacoEditor : public Wt::WContainerWidget {
 public:
@@ -19,6 +41,11 @@ public:
      * @param language Programming language for syntax highlighting (e.g., "javascript", "css", "html")
      */
     MonacoEditor(std::string language);
+
+    /**
+     * @brief Destructor - disposes the editor on the client
+     */
+    ~MonacoEditor() override;
     
     /**
      * @brief Sets the read-only state of the editor
@@ -33,27 +60,69 @@ public:
     bool unsavedChanges();
     
     /**
-     * @brief Gets the current unsaved text content
+     * @brief Gets the current unsaved text content of the active file
      * @return String containing the unsaved text
      */
-    std::string getUnsavedText() { return unsaved_text_; }
+    std::string getUnsavedText();
     
     /**
-     * @brief Marks the current text as saved (synchronizes current and unsaved text)
+     * @brief Marks the current text of the active file as saved
      */
     void textSaved();
     
     /**
      * @brief Loads content from a file into the editor
+     *
+     * Opens the file in a new tab, or reloads the tab already showing it. The
+     * server side buffer and the browser's download through an EditorFileResource
+     * both read the same cached mapping. Files above 1 MB are streamed into the
+     * editor in chunks and stay read-only until fully loaded.
      * @param resourcePath Path to the file to load
      */
     void setEditorText(std::string resourcePath);
+
+    /**
+     * @brief Shows a file, switching to its tab if it is already open
+     * @param path Path to the file
+     */
+    void openFile(const std::string& path);
+
+    /**
+     * @brief Closes the tab of a file, unsaved changes are dropped
+     * @param path Path to the file
+     */
+    void closeFile(const std::string& path);
+
+    /**
+     * @brief Path of the file in the active tab, empty if no file is open
+     */
+    std::string activeFile() const;
     
     /**
      * @brief Saves the current editor content to the selected file
+     *
+     * The write runs on the FileWriter thread, saveFinished() is emitted through
+     * server push once it is done.
      */
     void saveFile();
+
+    /**
+     * @brief Sets whether saves are fsynced before they are reported as done
+     * @param sync True to fsync, off by default
+     */
+    void setSaveSync(bool sync);
     
+    /**
+     * @brief Sets how long the client coalesces edits before sending them
+     *
+     * A typing burst is sent once typing pauses for idleMs, or at the latest
+     * maxLatencyMs after its first unsent change, as one delta. Only Ctrl+S and
+     * losing focus send the pending changes right away. Defaults to 300 and 1000 ms.
+     * @param idleMs Pause in typing that flushes the pending changes
+     * @param maxLatencyMs Longest time a change is held back while typing continues
+     */
+    void setSyncWindow(int idleMs, int maxLatencyMs);
+
     /**
      * @brief Toggles line wrapping in the editor
      */
@@ -99,6 +168,18 @@ public:
      * @return Signal that provides the new width
      */
     Wt::Signal<Wt::WString>& widthChanged() { return width_changed_; }
+
+    /**
+     * @brief Signal emitted when a save started with saveFile() finished
+     * @return Signal that provides whether the file was written
+     */
+    Wt::Signal<bool>& saveFinished() { return save_finished_; }
+
+    /**
+     * @brief Signal emitted when another tab becomes active
+     * @return Signal that provides the path of the active file, empty if none is open
+     */
+    Wt::Signal<std::string>& fileActivated() { return file_activated_; }
 protected:
     /**
      * @brief Called when the widget size changes
@@ -109,18 +190,124 @@ protected:
         
 private:
     /**
-     * @brief Callback for when editor text content changes
-     * @param text New text content
+     * @brief An open file and the state of its sync
      */
-    void editorTextChanged(std::string text);
+    struct Document {
+        std::string path;
+        PieceTable unsaved;                 ///< Unsaved text content, kept in sync through deltas
+        std::uint32_t saved_checksum = 0;   ///< PieceTable checksum of the saved text
+        std::size_t saved_size = 0;         ///< Size of the saved text in bytes
+        int seq = 0;                        ///< Sequence number of the last applied delta
+        bool resyncing = false;             ///< Waiting for the full text after a drift
+    };
 
-    std::string selected_file_path_;       ///< Path to currently selected file
-    std::string current_text_;             ///< Current saved text content
-    std::string unsaved_text_;             ///< Unsaved text content
-    std::string editor_js_var_name_;       ///< JavaScript variable name for this editor instance
-    
-    Wt::JSignal<std::string> js_signal_text_changed_;  ///< JavaScript signal for text changes
+    /**
+     * @brief The document of the active tab, nullptr if no file is open
+     */
+    Document* activeDocument();
+
+    /**
+     * @brief Drops a document, choosing the next active one like the client does
+     */
+    void removeDocument(int generation);
+
+    /**
+     * @brief Calls a function of StylusComponents.monacoEditor for this editor
+     * @param method Name of the function
+     * @param arguments JavaScript arguments after the widget id, each starting with ", "
+     */
+    void callClient(const std::string& method, const std::string& arguments = "");
+
+    /**
+     * @brief Applies a batch of Monaco content changes
+     * @param generation Document generation the changes were made against
+     * @param seq Sequence number of the batch, one more than the previous one
+     * @param changes JSON array of [rangeOffset, rangeLength, text] in UTF-16 offsets
+     */
+    void editorDelta(int generation, int seq, std::string changes);
+
+    /**
+     * @brief Compares the client's checksum with the one of the synced text
+     * @param generation Document generation the checksum was computed for
+     * @param seq Sequence number of the last batch included in the checksum
+     * @param checksum FNV-1a hash of the client text as hex
+     */
+    void editorChecksum(int generation, int seq, std::string checksum);
+
+    /**
+     * @brief Replaces the synced text with the full client text
+     * @param generation Document generation of the text
+     * @param seq Sequence number of the last batch included in the text
+     * @param text Full editor text
+     */
+    void editorResync(int generation, int seq, std::string text);
+
+    /**
+     * @brief Asks the client for the full text of a document, ignoring its deltas until it arrives
+     */
+    void requestResync(int generation, Document& document);
+
+    /**
+     * @brief Records the tab the user switched to
+     * @param generation Generation of the now active document
+     */
+    void editorActivated(int generation);
+
+    /**
+     * @brief Drops the document of a tab the user closed
+     * @param generation Generation of the closed document
+     */
+    void editorClosed(int generation);
+
+    /**
+     * @brief Logs how long the editor took to become usable
+     * @param milliseconds Time from the widget being rendered to the editor being created
+     * @param cached Whether Monaco was already loaded by an earlier editor
+     */
+    void editorReady(int milliseconds, bool cached);
+
+    /**
+     * @brief Schedules a background check of an XML document
+     */
+    void validate(int generation, const Document& document);
+
+    /**
+     * @brief Shows the result of a background check as markers
+     * @param generation Document the check was made for
+     * @param diagnostics Problems found, empty clears the markers
+     */
+    void showDiagnostics(int generation, const std::vector<XmlValidator::Diagnostic>& diagnostics);
+
+    /**
+     * @brief Key of a document for the XmlValidator, unique across sessions
+     */
+    std::string validationKey(int generation) const;
+
+    /**
+     * @brief Called in the session once the FileWriter is done with a save
+     * @param path Path that was written
+     * @param checksum Checksum of the text that was written
+     * @param size Size of the text that was written
+     * @param error Empty on success
+     */
+    void fileSaved(const std::string& path, std::uint32_t checksum, std::size_t size, const std::string& error);
+
+    std::map<int, Document> documents_;    ///< Open files by generation, also the tab order
+    int active_ = 0;                       ///< Generation of the active document, 0 if none
+    int sync_generation_ = 0;              ///< Bumped on each load, deltas of closed documents are dropped
+    std::shared_ptr<EditorFileResource> file_resource_;  ///< Serves the loaded files to the editor
+    bool save_sync_ = false;               ///< fsync saves before reporting them
+    std::string session_id_;               ///< Session of the editor, for posting background results
+
+    Wt::JSignal<int, int, std::string> js_signal_delta_;     ///< JavaScript signal for content changes
+    Wt::JSignal<int, int, std::string> js_signal_checksum_;  ///< JavaScript signal for the periodic checksum
+    Wt::JSignal<int, int, std::string> js_signal_resync_;    ///< JavaScript signal for the full text
+    Wt::JSignal<int, bool> js_signal_ready_;                  ///< JavaScript signal for the time to ready
+    Wt::JSignal<int> js_signal_activated_;                    ///< JavaScript signal for tab switches
+    Wt::JSignal<int> js_signal_closed_;                       ///< JavaScript signal for closed tabs
     Wt::Signal<> available_save_;                       ///< Signal for save availability
     Wt::Signal<std::string> save_file_signal_;          ///< Signal for save file operation
     Wt::Signal<Wt::WString> width_changed_;             ///< Signal for width changes
+    Wt::Signal<bool> save_finished_;                    ///< Signal for finished saves
+    Wt::Signal<std::string> file_activated_;            ///< Signal for tab switches
 };
\ No newline at end of file
@@ -0,0 +1,217 @@
+#include "005_Components/PieceTable.h"
+
+#include <algorithm>
+
+namespace {
+
+// UTF-16 code units encoded by a UTF-8 lead byte, 0 for continuation bytes
+std::size_t utf16Units(unsigned char c)
+{
+    if (c < 0x80) {
+        return 1;
+    }
+    if (c < 0xC0) {
+        return 0;
+    }
+    return c < 0xF0 ? 1 : 2;
+}
+
+// Capacity of a block of inserted text, larger insertions get a block of their own size
+const std::size_t BLOCK_BYTES = 16 * 1024;
+
+const std::uint32_t FNV_OFFSET_BASIS = 2166136261u;
+const std::uint32_t FNV_PRIME = 16777619u;
+
+std::uint32_t fnv1a(std::uint32_t hash, std::string_view text)
+{
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+}
+
+PieceTable::PieceTable()
+{
+}
+
+void PieceTable::reset(std::string text)
+{
+    auto owner = std::make_shared<const std::string>(std::move(text));
+    const std::string_view view(*owner);
+    reset(view, std::move(owner));
+}
+
+void PieceTable::reset(std::string_view text, std::shared_ptr<const void> owner)
+{
+    original_owner_ = std::move(owner);
+    original_ = text;
+    added_.clear();
+    pieces_.clear();
+    size_ = original_.size();
+    units_ = 0;
+    checksum_valid_ = false;
+    if (size_ > 0) {
+        pieces_.push_back(makePiece(ORIGINAL, 0, size_));
+        units_ = pieces_.back().units;
+    }
+}
+
+std::string_view PieceTable::buffer(const Piece& piece) const
+{
+    const std::string_view source = piece.block == ORIGINAL ? original_ : std::string_view(*added_[piece.block]);
+    return source.substr(piece.start, piece.bytes);
+}
+
+PieceTable::Piece PieceTable::makePiece(std::size_t block, std::size_t start, std::size_t bytes) const
+{
+    Piece piece{block, start, bytes, 0, true};
+    for (unsigned char c : buffer(piece)) {
+        piece.units += utf16Units(c);
+        piece.ascii = piece.ascii && c < 0x80;
+    }
+    return piece;
+}
+
+/*
+ * Makes sure a piece boundary falls on the given UTF-16 offset and returns the
+ * index of the piece starting there (pieces_.size() at the end of the text).
+ */
+std::size_t PieceTable::splitAt(std::size_t units)
+{
+    std::size_t index = 0;
+    while (index < pieces_.size()) {
+        if (units == 0) {
+            return index;
+        }
+        Piece& piece = pieces_[index];
+        if (units >= piece.units) {
+            units -= piece.units;
+            ++index;
+            continue;
+        }
+
+        // The offset falls inside this piece, find the byte to split at
+        std::size_t bytes = units;
+        std::size_t seen = units;
+        if (!piece.ascii) {
+            const std::string_view text = buffer(piece);
+            seen = 0;
+            bytes = 0;
+            while (bytes < text.size() && seen < units) {
+                seen += utf16Units(static_cast<unsigned char>(text[bytes]));
+                ++bytes;
+                while (bytes < text.size() && utf16Units(static_cast<unsigned char>(text[bytes])) == 0) {
+                    ++bytes;
+                }
+            }
+        }
+
+        // An offset inside a surrogate pair splits after it. Both halves keep the
+        // ascii flag of the whole, which is only ever too pessimistic.
+        const Piece left{piece.block, piece.start, bytes, seen, piece.ascii};
+        const Piece right{piece.block, piece.start + bytes, piece.bytes - bytes, piece.units - seen, piece.ascii};
+        pieces_[index] = left;
+        pieces_.insert(pieces_.begin() + index + 1, right);
+        return index + 1;
+    }
+    return index;
+}
+
+bool PieceTable::replace(std::size_t offset, std::size_t length, const std::string& text)
+{
+    // Written so that huge values cannot wrap around
+    if (offset > units_ || length > units_ - offset) {
+        return false;
+    }
+
+    checksum_valid_ = false;
+    const std::size_t first = splitAt(offset);
+    if (length > 0) {
+        const std::size_t last = splitAt(offset + length);
+        if (last < first) {
+            return false;
+        }
+        for (std::size_t i = first; i < last; ++i) {
+            size_ -= pieces_[i].bytes;
+            units_ -= pieces_[i].units;
+        }
+        pieces_.erase(pieces_.begin() + first, pieces_.begin() + last);
+    }
+
+    if (text.empty()) {
+        return true;
+    }
+
+    // Appending within the capacity never moves the bytes snapshots point to
+    if (added_.empty() || added_.back()->capacity() - added_.back()->size() < text.size()) {
+        auto block = std::make_shared<std::string>();
+        block->reserve(std::max(BLOCK_BYTES, text.size()));
+        added_.push_back(std::move(block));
+    }
+    const std::size_t block = added_.size() - 1;
+    const std::size_t start = added_.back()->size();
+    added_.back()->append(text);
+    size_ += text.size();
+
+    // Typing appends to the piece of the previous keystroke instead of adding one
+    const Piece inserted = makePiece(block, start, text.size());
+    units_ += inserted.units;
+    if (first > 0) {
+        Piece& previous = pieces_[first - 1];
+        if (previous.block == block && previous.start + previous.bytes == start) {
+            previous.bytes += inserted.bytes;
+            previous.units += inserted.units;
+            previous.ascii = previous.ascii && inserted.ascii;
+            return true;
+        }
+    }
+    pieces_.insert(pieces_.begin() + first, inserted);
+    return true;
+}
+
+std::string PieceTable::text() const
+{
+    std::string result;
+    result.reserve(size_);
+    for (const Piece& piece : pieces_) {
+        result.append(buffer(piece));
+    }
+    return result;
+}
+
+PieceTable::Snapshot PieceTable::snapshot() const
+{
+    // Shares the blocks, later insertions only write past what the parts cover
+    struct Owner {
+        std::shared_ptr<const void> original;
+        std::vector<std::shared_ptr<std::string>> added;
+    };
+
+    Snapshot snapshot;
+    snapshot.parts.reserve(pieces_.size());
+    for (const Piece& piece : pieces_) {
+        snapshot.parts.push_back(buffer(piece));
+    }
+    snapshot.owner = std::make_shared<Owner>(Owner{original_owner_, added_});
+    return snapshot;
+}
+
+std::uint32_t PieceTable::checksum() const
+{
+    if (!checksum_valid_) {
+        checksum_ = FNV_OFFSET_BASIS;
+        for (const Piece& piece : pieces_) {
+            checksum_ = fnv1a(checksum_, buffer(piece));
+        }
+        checksum_valid_ = true;
+    }
+    return checksum_;
+}
+
+std::uint32_t PieceTable::checksum(std::string_view text)
+{
+    return fnv1a(FNV_OFFSET_BASIS, text);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Editable text buffer that never copies the text it was loaded with
+ *
+ * Stores UTF-8 text as a list of pieces pointing either into the original text
+ * or into append-only blocks holding everything inserted since. A block is
+ * never reallocated, bytes once written never move or change, so snapshots can
+ * share the blocks instead of copying them. Offsets given
+ * to replace() are UTF-16 code units, which is what Monaco reports in its change
+ * events, so edits from the browser can be applied without converting the text.
+ */
+class PieceTable {
+public:
+    PieceTable();
+
+    /**
+     * @brief Replaces the whole content, dropping every edit
+     * @param text New original text
+     */
+    void reset(std::string text);
+
+    /**
+     * @brief Replaces the whole content with text owned by someone else, without copying it
+     * @param text New original text
+     * @param owner Keeps the memory of text alive for as long as the buffer uses it
+     */
+    void reset(std::string_view text, std::shared_ptr<const void> owner);
+
+    /**
+     * @brief Replaces a range of the text
+     * @param offset Start of the range in UTF-16 code units
+     * @param length Length of the range in UTF-16 code units
+     * @param text UTF-8 text to insert in its place
+     * @return false, leaving the text unchanged, if the range does not lie within the text
+     */
+    bool replace(std::size_t offset, std::size_t length, const std::string& text);
+
+    /**
+     * @brief Materializes the current text
+     */
+    std::string text() const;
+
+    /**
+     * @brief Read-only view of the text at one point in time
+     */
+    struct Snapshot {
+        std::vector<std::string_view> parts;    ///< the text, in order
+        std::shared_ptr<const void> owner;      ///< keeps the memory of parts alive
+    };
+
+    /**
+     * @brief Takes a snapshot of the current text
+     *
+     * Nothing is copied: the parts point into the original text and the blocks of
+     * inserted text, which the snapshot shares. The cost is one view per piece.
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Size of the current text in bytes
+     */
+    std::size_t size() const { return size_; }
+
+    /**
+     * @brief Length of the current text in UTF-16 code units, the end of the range replace() accepts
+     */
+    std::size_t units() const { return units_; }
+
+    /**
+     * @brief FNV-1a hash of the current text's UTF-8 bytes
+     *
+     * Computed on the first call after a change and kept until the next one, so
+     * asking again is free. Like every other member, not safe to call from
+     * several threads at once.
+     */
+    std::uint32_t checksum() const;
+
+    /**
+     * @brief FNV-1a hash of a UTF-8 string, same algorithm as checksum()
+     */
+    static std::uint32_t checksum(std::string_view text);
+
+private:
+    static constexpr std::size_t ORIGINAL = static_cast<std::size_t>(-1);
+
+    struct Piece {
+        std::size_t block;      ///< index in added_, ORIGINAL for original_
+        std::size_t start;      ///< byte offset in its buffer
+        std::size_t bytes;      ///< length in bytes
+        std::size_t units;      ///< length in UTF-16 code units
+        bool ascii;             ///< bytes == units, no decoding needed to split
+    };
+
+    std::string_view buffer(const Piece& piece) const;
+    Piece makePiece(std::size_t block, std::size_t start, std::size_t bytes) const;
+    std::size_t splitAt(std::size_t units);
+
+    std::shared_ptr<const void> original_owner_;    ///< keeps original_ alive
+    std::string_view original_;                     ///< text the buffer was loaded with
+    std::vector<std::shared_ptr<std::string>> added_; ///< blocks of inserted text, each filled up to its capacity
+    std::vector<Piece> pieces_;
+    std::size_t size_ = 0;
+    std::size_t units_ = 0;
+    mutable std::uint32_t checksum_ = 0;            ///< of the current text while checksum_valid_
+    mutable bool checksum_valid_ = false;
+};
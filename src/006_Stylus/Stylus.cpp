@@ -1,19 +1,81 @@
 #include "006_Stylus/Stylus.h"
+#include "004_Theme/Theme.h"
+#include "005_Components/DragBar.h"
+#include "005_Components/MonacoEditor.h"
+#include "009_Services/TemplateHotSwap.h"
 #include <Wt/WLength.h>
 #include <Wt/WApplication.h>
 #include <Wt/WTemplate.h>
 #include <Wt/WAnchor.h>
+#include <Wt/WImage.h>
+#include <Wt/WPushButton.h>
+#include <Wt/WServer.h>
+#include <Wt/WText.h>
+#include <Wt/Utils.h>
+#include <Wt/Core/observing_ptr.hpp>
+#include <cstdio>
+#include <cstdlib>
 
 namespace Stylus {
 
+namespace {
+
+// ThumbnailResource, serving static/, so the FileIndex paths get the 0_stylus/ prefix
+const std::string THUMBNAILS_URL = "/thumbnails/0_stylus/";
+const int THUMBNAIL_WIDTH = 128;
+// Width of the file list of a panel with an editor, until the user drags it
+const int FILE_LIST_WIDTH = 220;
+
+// The mtime makes the URL change with the image, so the browser may cache it for good
+std::string thumbnailUrl(const FileIndex::File& file)
+{
+    char version[17];
+    std::snprintf(version, sizeof(version), "%llx", static_cast<unsigned long long>(file.mtime));
+    return THUMBNAILS_URL + Wt::Utils::urlEncode(file.path, "/") + "?w=" + std::to_string(THUMBNAIL_WIDTH)
+        + "&v=" + version;
+}
+
+}
+
 Stylus::Stylus(Session& session)
     : Wt::WDialog(),
-      session_(session),
-      stylus_state_()
+      session_(session)
 {
     initializeDialog();
     setupKeyboardShortcuts();
     setupContent();
+
+    // The index is shared by all sessions, a change reaches every open dialog
+    files_ = FileIndex::instance().snapshot();
+    const std::string session_id = wApp->sessionId();
+    Wt::Core::observing_ptr<Stylus> self(this);
+    wApp->enableUpdates(true);
+    file_index_listener_ = FileIndex::instance().subscribe([=](std::shared_ptr<const FileIndex::Snapshot> snapshot) {
+        if (auto server = Wt::WServer::instance()) {
+            server->post(session_id, [=]() {
+                if (self) {
+                    self->filesChanged(snapshot);
+                    wApp->triggerUpdate();
+                }
+            });
+        }
+    });
+    tailwind_listener_ = TailwindBuilder::instance().subscribe([=](const TailwindBuilder::Stats& stats) {
+        if (auto server = Wt::WServer::instance()) {
+            server->post(session_id, [=]() {
+                if (self) {
+                    self->showBuildStats(stats);
+                    wApp->triggerUpdate();
+                }
+            });
+        }
+    });
+}
+
+Stylus::~Stylus()
+{
+    FileIndex::instance().unsubscribe(file_index_listener_);
+    TailwindBuilder::instance().unsubscribe(tailwind_listener_);
 }
 
 void Stylus::initializeDialog()
@@ -37,23 +99,24 @@ void Stylus::initializeDialog()
 
 void Stylus::setupKeyboardShortcuts()
 {
-    wApp->doJavaScript(WT_CLASS R"(
-        .$(')" + id() + R"(').oncontextmenu = function() {
+    // Bound to the dialog element, so it goes away with it and keys outside Stylus keep
+    // their browser defaults. Ctrl+S only needs this outside the editors, Monaco handles its own.
+    doJavaScript(jsRef() + R"(.oncontextmenu = function(event) {
             event.cancelBubble = true;
             event.returnValue = false;
             return false;
         };
-        document.addEventListener('keydown', function(event) {
+        )" + jsRef() + R"(.onkeydown = function(event) {
             if (event.altKey && (event.key === 'ArrowLeft' || event.key === 'ArrowRight')) {
                 event.preventDefault();
-                // Your custom logic here if needed
             } else if ((event.ctrlKey || event.metaKey) && event.key === 's') {
                 event.preventDefault();
             }
-        });
+        };
     )");
 
-    wApp->globalKeyWentDown().connect([=](Wt::WKeyEvent e) { keyWentDown(e); });
+    // Bound to this, so the connection goes away with the dialog when App removes it
+    wApp->globalKeyWentDown().connect(this, &Stylus::keyWentDown);
 }
 
 void Stylus::setupContent()
@@ -80,12 +143,30 @@ void Stylus::setupContent()
     images_files_wrapper_ = images_files_wrapper.get();
     settings_wrapper_ = settings_wrapper.get();
 
-    xml_menu_item_ = menu_->addItem("", std::move(xml_files_wrapper));
-    css_menu_item_ = menu_->addItem("", std::move(css_files_wrapper));
-    js_menu_item_ = menu_->addItem("", std::move(js_files_wrapper));
-    tailwind_menu_item_ = menu_->addItem("", std::move(tailwind_files_wrapper));
-    images_menu_item_ = menu_->addItem("", std::move(images_files_wrapper));
-    settings_menu_item_ = menu_->addItem("", std::move(settings_wrapper));
+    xml_menu_item_ = menu_->addItem("", std::move(xml_files_wrapper), Wt::ContentLoading::Lazy);
+    css_menu_item_ = menu_->addItem("", std::move(css_files_wrapper), Wt::ContentLoading::Lazy);
+    js_menu_item_ = menu_->addItem("", std::move(js_files_wrapper), Wt::ContentLoading::Lazy);
+    tailwind_menu_item_ = menu_->addItem("", std::move(tailwind_files_wrapper), Wt::ContentLoading::Lazy);
+    images_menu_item_ = menu_->addItem("", std::move(images_files_wrapper), Wt::ContentLoading::Lazy);
+    settings_menu_item_ = menu_->addItem("", std::move(settings_wrapper), Wt::ContentLoading::Lazy);
+
+    // Panels are built on their first selection, see buildPanel()
+    panels_[xml_menu_item_] = FilePanel{"xml", ".xml", "xml", xml_files_wrapper_};
+    panels_[css_menu_item_] = FilePanel{"tailwind/css", ".css", "css", css_files_wrapper_};
+    panels_[js_menu_item_] = FilePanel{"js", ".js", "javascript", js_files_wrapper_};
+    panels_[tailwind_menu_item_] = FilePanel{"tailwind", "input.css", "css", tailwind_files_wrapper_};
+    panels_[images_menu_item_] = FilePanel{"images", "", "", images_files_wrapper_};
+    panels_[images_menu_item_].thumbnails = true;
+    menu_->itemSelected().connect(this, &Stylus::buildPanel);
+
+    // The last panel used is kept in the shared state, a selection is one journal line
+    const int panel = std::atoi(StylusState::instance().snapshot()->value("settings", "panel", "0").c_str());
+    if (panel > 0 && panel < menu_->count()) {
+        menu_->select(panel);
+    }
+    menu_->itemSelected().connect([this]() {
+        StylusState::instance().set("settings", "panel", std::to_string(menu_->currentIndex()));
+    });
 
     auto xml_icon = xml_menu_item_->anchor()->insertNew<Wt::WTemplate>(0, Wt::WString::tr("stylus-svg-xml-logo"));
     auto css_icon = css_menu_item_->anchor()->insertNew<Wt::WTemplate>(0, Wt::WString::tr("stylus-svg-css-logo"));
@@ -93,6 +174,9 @@ void Stylus::setupContent()
     auto tailwind_icon = tailwind_menu_item_->anchor()->insertNew<Wt::WTemplate>(0, Wt::WString::tr("stylus-svg-tailwind-logo"));
     auto images_icon = images_menu_item_->anchor()->insertNew<Wt::WTemplate>(0, Wt::WString::tr("stylus-svg-images-logo"));
     auto settings_icon = settings_menu_item_->anchor()->insertNew<Wt::WTemplate>(0, Wt::WString::tr("stylus-svg-settings-logo"));
+    for (Wt::WTemplate* icon : {xml_icon, css_icon, js_icon, tailwind_icon, images_icon, settings_icon}) {
+        TemplateHotSwap::instance().watch(icon);
+    }
 
     std::string nav_btns_styles = "w-[35px] m-[3px] !p-1 cursor-pointer rounded-md flex items-center justify-center";
 
@@ -104,16 +188,170 @@ void Stylus::setupContent()
     settings_menu_item_->anchor()->setStyleClass(nav_btns_styles);
 }
 
+void Stylus::buildPanel(Wt::WMenuItem* item)
+{
+    if (item == settings_menu_item_) {
+        buildSettings();
+        return;
+    }
+
+    auto it = panels_.find(item);
+    if (it == panels_.end() || it->second.list != nullptr) {
+        return;
+    }
+
+    FilePanel& panel = it->second;
+    panel.wrapper->setStyleClass("flex h-full w-full");
+    panel.list = panel.wrapper->addNew<Wt::WContainerWidget>();
+    if (panel.thumbnails) {
+        panel.list->setStyleClass("grid grid-cols-[repeat(auto-fill,minmax(128px,1fr))] gap-2 p-2 w-full content-start overflow-auto text-xs");
+    } else {
+        panel.list->setStyleClass("flex flex-col shrink-0 overflow-hidden border-r border-gray-200 text-sm");
+    }
+    if (!panel.language.empty()) {
+        // Each user keeps the width they dragged the file list to, per panel
+        auto drag_bar = panel.wrapper->addNew<DragBar>(panel.list, FILE_LIST_WIDTH, 120, 600);
+        const std::string user_id = session_.login().loggedIn() ? session_.login().user().id() : std::string();
+        drag_bar->persistWidth(user_id, "stylus.file-list-width." + panel.directory);
+        auto editor_column = panel.wrapper->addNew<Wt::WContainerWidget>();
+        editor_column->setStyleClass("flex flex-col flex-1 h-full min-w-0");
+        panel.editor = editor_column->addNew<MonacoEditor>(panel.language);
+        panel.editor->setStyleClass("flex-1 min-h-0");
+        panel.save_status = editor_column->addNew<Wt::WText>();
+        panel.save_status->setStyleClass("px-2 py-1 text-xs border-t border-gray-200");
+
+        // Ctrl+S in the editor saves through the FileWriter, see MonacoEditor::saveFile()
+        FilePanel* status_panel = &panel;
+        panel.editor->availableSave().connect([this, status_panel]() { showSaveStatus(*status_panel); });
+        panel.editor->fileActivated().connect([this, status_panel](const std::string&) { showSaveStatus(*status_panel); });
+        panel.editor->saveFinished().connect([this, status_panel](bool ok) {
+            showSaveStatus(*status_panel);
+            if (!ok) {
+                status_panel->save_status->setText("Saving failed, the file on disk is unchanged");
+            }
+            status_panel->save_status->toggleStyleClass("text-red-600", !ok);
+        });
+    }
+    showFiles(panel);
+}
+
+void Stylus::showFiles(FilePanel& panel)
+{
+    panel.list->clear();
+    const std::size_t prefix = panel.directory.size() + 1;
+    for (const FileIndex::File* file : files_->list(panel.directory, panel.extension)) {
+        if (panel.thumbnails) {
+            // Resized on the server, a grid of originals would be megabytes
+            const Wt::WString name = Wt::WString::fromUTF8(file->path.substr(prefix));
+            auto tile = panel.list->addNew<Wt::WContainerWidget>();
+            tile->setStyleClass("flex flex-col items-center gap-1 min-w-0");
+            auto image = tile->addNew<Wt::WImage>(Wt::WLink(thumbnailUrl(*file)), name);
+            image->setStyleClass("w-full aspect-square object-contain rounded-md bg-surface");
+            tile->addNew<Wt::WText>(name, Wt::TextFormat::Plain)->setStyleClass("w-full truncate text-center");
+            continue;
+        }
+        auto entry = panel.list->addNew<Wt::WText>(Wt::WString::fromUTF8(file->path.substr(prefix)), Wt::TextFormat::Plain);
+        entry->setStyleClass("px-2 cursor-pointer whitespace-nowrap");
+        if (MonacoEditor* editor = panel.editor) {
+            const std::string path = files_->root + "/" + file->path;
+            entry->clicked().connect([editor, path]() { editor->openFile(path); });
+        }
+    }
+}
+
+void Stylus::showSaveStatus(FilePanel& panel)
+{
+    if (panel.editor->activeFile().empty()) {
+        panel.save_status->setText("");
+    } else {
+        panel.save_status->setText(panel.editor->unsavedChanges() ? "Unsaved changes - Ctrl+S to save" : "Saved");
+    }
+    panel.save_status->removeStyleClass("text-red-600");
+}
+
+void Stylus::filesChanged(std::shared_ptr<const FileIndex::Snapshot> snapshot)
+{
+    if (snapshot->version <= files_->version) {
+        return;
+    }
+    files_ = std::move(snapshot);
+    // Panels not built yet read the newest snapshot when they are
+    for (auto& entry : panels_) {
+        if (entry.second.list != nullptr) {
+            showFiles(entry.second);
+        }
+    }
+}
+
+void Stylus::buildSettings()
+{
+    if (build_status_ != nullptr) {
+        return;
+    }
+
+    settings_wrapper_->setStyleClass("flex flex-col gap-2 p-4 text-sm");
+    settings_wrapper_->addNew<Wt::WText>("Tailwind build")->setStyleClass("font-semibold");
+    build_status_ = settings_wrapper_->addNew<Wt::WText>();
+    build_status_->setTextFormat(Wt::TextFormat::Plain);
+    build_error_ = settings_wrapper_->addNew<Wt::WText>();
+    build_error_->setTextFormat(Wt::TextFormat::Plain);
+    build_error_->setStyleClass("whitespace-pre-wrap font-mono text-xs text-red-600");
+
+    auto rebuild = settings_wrapper_->addNew<Wt::WPushButton>("Rebuild now");
+    rebuild->setStyleClass("self-start");
+    rebuild->clicked().connect([]() { TailwindBuilder::instance().rebuild(); });
+
+    showBuildStats(TailwindBuilder::instance().stats());
+}
+
+void Stylus::showBuildStats(const TailwindBuilder::Stats& stats)
+{
+    // Not built yet, buildSettings() reads the current stats when it is
+    if (build_status_ == nullptr) {
+        return;
+    }
+
+    std::string state;
+    switch (stats.state) {
+    case TailwindBuilder::State::Idle:
+        state = "Idle";
+        break;
+    case TailwindBuilder::State::Waiting:
+        state = "Waiting for edits to settle";
+        break;
+    case TailwindBuilder::State::Building:
+        state = stats.queued ? "Building, restarting for newer edits" : "Building";
+        break;
+    }
+
+    std::string text = state + " - " + std::to_string(stats.builds) + " built, "
+        + std::to_string(stats.cancelled) + " cancelled, " + std::to_string(stats.failures) + " failed";
+    if (stats.builds > 0 || stats.failures > 0) {
+        text += " - last build " + std::to_string(stats.last_duration.count()) + " ms";
+    }
+    if (stats.last_size > 0) {
+        text += ", " + std::to_string((stats.last_size + 1023) / 1024) + " KB after pruning";
+    }
+    build_status_->setText(Wt::WString::fromUTF8(text));
+    build_error_->setText(Wt::WString::fromUTF8(stats.last_error));
+}
+
+void Stylus::toggle()
+{
+    if (isHidden()) {
+        Theme::useStyleSheetChunk("stylus");
+        buildPanel(menu_->currentItem());
+        show();
+    } else {
+        hide();
+    }
+}
+
 void Stylus::keyWentDown(Wt::WKeyEvent e)
 {
+    // Alt+Q is handled by App, which constructs the dialog on first use
     if (e.modifiers().test(Wt::KeyboardModifier::Alt)) {
-        if (e.key() == Wt::Key::Q) {
-            if (isHidden()) {
-                show();
-            } else {
-                hide();
-            }
-        } else if (e.key() == Wt::Key::Key_1) {
+        if (e.key() == Wt::Key::Key_1) {
             menu_->select(0);
         } else if (e.key() == Wt::Key::Key_2) {
             menu_->select(1);
@@ -5,15 +5,33 @@
 #include <Wt/WMenuItem.h>
 #include <Wt/WContainerWidget.h>
 #include <Wt/WStackedWidget.h>
+#include <Wt/WText.h>
 #include "002_Dbo/Session.h"
 #include "007_State/StylusState.h"
+#include "009_Services/FileIndex.h"
+#include "009_Services/TailwindBuilder.h"
+
+#include <map>
+#include <memory>
+
+class MonacoEditor;
 
 namespace Stylus {
 
+/*
+ * The Stylus editor dialog. App only constructs it on the first Alt+Q of a user
+ * with the STYLUS permission, and each panel is only built the first time it is
+ * selected. The file lists of the panels come from the shared FileIndex and are
+ * updated through server push when files change.
+ */
 class Stylus : public Wt::WDialog
 {
 public:
     Stylus(Session& session);
+    ~Stylus() override;
+
+    // Shows or hides the dialog, bound to Alt+Q by App
+    void toggle();
 
 private:
     void initializeDialog();
@@ -21,6 +39,29 @@ private:
     void setupKeyboardShortcuts();
     void keyWentDown(Wt::WKeyEvent e);
 
+    // A panel listing the files of one directory of static/0_stylus
+    struct FilePanel {
+        std::string directory;              // relative to static/0_stylus
+        std::string extension;              // empty for any file
+        std::string language;               // empty for panels without an editor
+        Wt::WContainerWidget* wrapper = nullptr;
+        Wt::WContainerWidget* list = nullptr;
+        MonacoEditor* editor = nullptr;
+        Wt::WText* save_status = nullptr;   // below the editor, unsaved changes and the outcome of saves
+        bool thumbnails = false;            // shows the files as a grid of images
+    };
+
+    // Builds the contents of a panel the first time its menu item is selected
+    void buildPanel(Wt::WMenuItem* item);
+    void showFiles(FilePanel& panel);
+    void showSaveStatus(FilePanel& panel);
+    // Called in the session when the FileIndex published a new snapshot
+    void filesChanged(std::shared_ptr<const FileIndex::Snapshot> snapshot);
+
+    // The settings panel, with the state of the background Tailwind build
+    void buildSettings();
+    void showBuildStats(const TailwindBuilder::Stats& stats);
+
     Session& session_;
 
     Wt::WContainerWidget* navbar_wrapper_;
@@ -41,7 +82,14 @@ private:
     Wt::WMenuItem* images_menu_item_;
     Wt::WMenuItem* settings_menu_item_;
 
-    StylusState* stylus_state_;
+    std::map<Wt::WMenuItem*, FilePanel> panels_;
+    std::shared_ptr<const FileIndex::Snapshot> files_;
+    int file_index_listener_ = 0;
+
+    Wt::WText* build_status_ = nullptr;
+    Wt::WText* build_error_ = nullptr;
+    int tailwind_listener_ = 0;
+
 };
 
 }
\ No newline at end of file
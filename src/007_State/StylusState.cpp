@@ -1,8 +1,310 @@
 #include "007_State/StylusState.h"
+#include "009_Services/FileWriter.h"
+
+#include <Wt/WLogger.h>
+
+#include <tinyxml2.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// The journal is folded into the state file after this many changes...
+const std::size_t COMPACT_ENTRIES = 64;
+// ...or once no change came in for this long
+const std::chrono::seconds COMPACT_IDLE(5);
+
+std::string escape(const std::string& text)
+{
+    std::string result;
+    for (char c : text) {
+        if (c == '\\') {
+            result += "\\\\";
+        } else if (c == '\t') {
+            result += "\\t";
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+std::string unescape(const std::string& text)
+{
+    std::string result;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            const char c = text[++i];
+            result += c == 't' ? '\t' : (c == 'n' ? '\n' : c);
+        } else {
+            result += text[i];
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> splitTabs(const std::string& line)
+{
+    std::vector<std::string> fields;
+    std::stringstream stream(line);
+    std::string field;
+    while (std::getline(stream, field, '\t')) {
+        fields.push_back(unescape(field));
+    }
+    return fields;
+}
+
+}
+
+std::string StylusState::Snapshot::value(const std::string& section, const std::string& key,
+                                         const std::string& fallback) const
+{
+    const Section* values = this->section(section);
+    if (!values) {
+        return fallback;
+    }
+    auto it = values->find(key);
+    return it != values->end() ? it->second : fallback;
+}
+
+const StylusState::Section* StylusState::Snapshot::section(const std::string& name) const
+{
+    auto it = sections_.find(name);
+    return it != sections_.end() ? it->second.get() : nullptr;
+}
+
+StylusState& StylusState::instance()
+{
+    static StylusState state;
+    return state;
+}
 
 StylusState::StylusState()
-    : doc_(std::make_shared<tinyxml2::XMLDocument>())
+    : snapshot_(std::make_shared<const Snapshot>())
 {
-    state_file_path_ = "../../static/stylus/stylus-state.xml";
+}
+
+StylusState::~StylusState()
+{
+    // What is still only in the journal is written to the state file
+    if (worker_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        worker_.join();
+    }
+}
+
+void StylusState::load(const std::string& path)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!path_.empty()) {
+            return;
+        }
+        path_ = path;
+        journal_path_ = path + ".journal";
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+    tinyxml2::XMLDocument doc;
+    if (doc.LoadFile(path.c_str()) == tinyxml2::XML_SUCCESS && doc.RootElement()) {
+        for (auto element = doc.RootElement()->FirstChildElement(); element; element = element->NextSiblingElement()) {
+            for (auto attribute = element->FirstAttribute(); attribute; attribute = attribute->Next()) {
+                apply(Change{false, element->Name(), attribute->Name(), attribute->Value()}, false);
+            }
+        }
+    } else if (std::filesystem::exists(path, error)) {
+        Wt::log("error") << "StylusState: cannot parse " << path << ": " << doc.ErrorStr();
+    }
+
+    // A line without its newline was cut off while being written and is skipped
+    std::ifstream journal(journal_path_, std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(journal)), std::istreambuf_iterator<char>());
+    std::size_t start = 0;
+    std::size_t replayed = 0;
+    for (std::size_t end; (end = contents.find('\n', start)) != std::string::npos; start = end + 1) {
+        const std::vector<std::string> fields = splitTabs(contents.substr(start, end - start));
+        if (fields.size() == 4 && fields[0] == "s") {
+            apply(Change{false, fields[1], fields[2], fields[3]}, false);
+        } else if (fields.size() == 3 && fields[0] == "e") {
+            apply(Change{true, fields[1], fields[2], ""}, false);
+        } else {
+            continue;
+        }
+        ++replayed;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        journal_entries_ = replayed;
+        last_change_ = std::chrono::steady_clock::now();
+    }
+    worker_ = std::thread(&StylusState::run, this);
+}
+
+std::shared_ptr<const StylusState::Snapshot> StylusState::snapshot() const
+{
+    return std::atomic_load(&snapshot_);
+}
+
+void StylusState::set(const std::string& section, const std::string& key, const std::string& value)
+{
+    apply(Change{false, section, key, value}, true);
+}
+
+void StylusState::erase(const std::string& section, const std::string& key)
+{
+    apply(Change{true, section, key, ""}, true);
+}
+
+void StylusState::apply(const Change& change, bool journal)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    const std::shared_ptr<const Snapshot> current = std::atomic_load(&snapshot_);
+    const Section* values = current->section(change.section);
+    if (change.erase && (!values || !values->count(change.key))) {
+        return;
+    }
+    if (!change.erase && values) {
+        auto it = values->find(change.key);
+        if (it != values->end() && it->second == change.value) {
+            return;
+        }
+    }
+
+    // Only the changed section is copied, the others are shared with the previous snapshot
+    auto section = values ? std::make_shared<Section>(*values) : std::make_shared<Section>();
+    if (change.erase) {
+        section->erase(change.key);
+    } else {
+        (*section)[change.key] = change.value;
+    }
+    auto next = std::make_shared<Snapshot>(*current);
+    next->version_ = current->version_ + 1;
+    next->sections_[change.section] = std::move(section);
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::move(next)));
+
+    if (journal && !path_.empty()) {
+        pending_.push_back(change);
+        lock.unlock();
+        wake_.notify_all();
+    }
+}
+
+void StylusState::compact()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!worker_.joinable()) {
+        return;
+    }
+    compact_requested_ = true;
+    wake_.notify_all();
+    wake_.wait(lock, [this] { return !compact_requested_; });
+}
+
+void StylusState::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait_for(lock, COMPACT_IDLE, [this] { return stopping_ || compact_requested_ || !pending_.empty(); });
+
+        if (!pending_.empty()) {
+            std::vector<Change> changes;
+            changes.swap(pending_);
+            lock.unlock();
+            appendJournal(changes);
+            lock.lock();
+            journal_entries_ += changes.size();
+            last_change_ = std::chrono::steady_clock::now();
+            if (!stopping_ && !compact_requested_) {
+                continue;
+            }
+        }
+
+        const bool idle = std::chrono::steady_clock::now() - last_change_ >= COMPACT_IDLE;
+        if (journal_entries_ > 0 && (journal_entries_ >= COMPACT_ENTRIES || idle || stopping_ || compact_requested_)) {
+            // The journal only ever grows here, changes arriving meanwhile wait in pending_
+            const std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&snapshot_);
+            lock.unlock();
+            writeStateFile(*snapshot);
+            lock.lock();
+            journal_entries_ = 0;
+        }
+        if (compact_requested_) {
+            compact_requested_ = false;
+            wake_.notify_all();
+        }
+        if (stopping_ && pending_.empty()) {
+            return;
+        }
+    }
+}
+
+void StylusState::appendJournal(const std::vector<Change>& changes)
+{
+    std::string lines;
+    for (const Change& change : changes) {
+        lines += change.erase ? "e\t" : "s\t";
+        lines += escape(change.section) + "\t" + escape(change.key);
+        if (!change.erase) {
+            lines += "\t" + escape(change.value);
+        }
+        lines += "\n";
+    }
+
+    const int fd = ::open(journal_path_.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0 || ::write(fd, lines.data(), lines.size()) != static_cast<ssize_t>(lines.size())) {
+        Wt::log("error") << "StylusState: failed to append to " << journal_path_ << ": " << std::strerror(errno);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+void StylusState::writeStateFile(const Snapshot& snapshot)
+{
+    tinyxml2::XMLDocument doc;
+    doc.InsertEndChild(doc.NewDeclaration());
+    tinyxml2::XMLElement* root = doc.NewElement("stylus");
+    doc.InsertEndChild(root);
+    for (const auto& section : snapshot.sections_) {
+        if (section.second->empty()) {
+            continue;
+        }
+        tinyxml2::XMLElement* element = doc.NewElement(section.first.c_str());
+        for (const auto& entry : *section.second) {
+            element->SetAttribute(entry.first.c_str(), entry.second.c_str());
+        }
+        root->InsertEndChild(element);
+    }
+
+    tinyxml2::XMLPrinter printer;
+    doc.Print(&printer);
+    const std::string_view content(printer.CStr(), printer.CStrSize() > 0 ? printer.CStrSize() - 1 : 0);
 
-}
\ No newline at end of file
+    // Replayed over the new file the journal would be harmless, it is emptied
+    // only once the file is in place
+    const std::string error = FileWriter::writeAtomically(path_, {content}, false);
+    if (!error.empty()) {
+        Wt::log("error") << "StylusState: " << error;
+        return;
+    }
+    if (::truncate(journal_path_.c_str(), 0) != 0 && errno != ENOENT) {
+        Wt::log("error") << "StylusState: failed to empty " << journal_path_ << ": " << std::strerror(errno);
+    }
+}
@@ -1,24 +1,93 @@
 #pragma once
 
-#include <tinyxml2.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
+/*
+ * Process-wide Stylus settings, shared by every session.
+ *
+ * The state is a set of sections (xml, css, js, tailwind-config, settings,
+ * images-manager, copy) holding key/value pairs. Readers get an immutable
+ * snapshot without taking a lock. A change publishes a new snapshot that only
+ * copies the section it touches, the others are shared with the previous one.
+ *
+ * Changes are appended to a journal next to the state file by a background
+ * thread. Once enough changes piled up, or the state was left alone for a
+ * while, the thread writes the whole state back to the XML file and empties the
+ * journal. Loading replays the journal over the XML file, so nothing is lost if
+ * the process stops in between.
+ */
+class StylusState {
+public:
+    using Section = std::map<std::string, std::string>;
 
+    class Snapshot {
+    public:
+        std::uint64_t version() const { return version_; }
+
+        // Value of a key, fallback if the section or the key does not exist
+        std::string value(const std::string& section, const std::string& key, const std::string& fallback = "") const;
+
+        // The section, nullptr if it does not exist
+        const Section* section(const std::string& name) const;
+
+    private:
+        friend class StylusState;
+
+        std::uint64_t version_ = 0;
+        std::map<std::string, std::shared_ptr<const Section>> sections_;
+    };
+
+    static StylusState& instance();
+
+    ~StylusState();
+
+    StylusState(const StylusState&) = delete;
+    StylusState& operator=(const StylusState&) = delete;
+
+    // Loads the state file and replays its journal, only the first call has an effect
+    void load(const std::string& path);
+
+    std::shared_ptr<const Snapshot> snapshot() const;
+
+    void set(const std::string& section, const std::string& key, const std::string& value);
+    void erase(const std::string& section, const std::string& key);
+
+    // Writes the state file and empties the journal now instead of in the background
+    void compact();
+
+private:
+    struct Change {
+        bool erase;
+        std::string section;
+        std::string key;
+        std::string value;
+    };
 
-struct StylusState {
     StylusState();
-    
-    std::string state_file_path_;
-
-    std::shared_ptr<tinyxml2::XMLDocument> doc_;
-    tinyxml2::XMLElement* stylus_node_ = nullptr;
-    tinyxml2::XMLElement* xml_node_ = nullptr;
-    tinyxml2::XMLElement* css_node_ = nullptr;
-    tinyxml2::XMLElement* js_node_ = nullptr;
-    tinyxml2::XMLElement* tailwind_config_node_ = nullptr;
-    tinyxml2::XMLElement* settings_node_ = nullptr;
-    tinyxml2::XMLElement* images_manager_node_ = nullptr;
-    tinyxml2::XMLElement* copy_node_ = nullptr;
-
-};
\ No newline at end of file
+
+    void apply(const Change& change, bool journal);
+    void run();
+    void appendJournal(const std::vector<Change>& changes);
+    void writeStateFile(const Snapshot& snapshot);
+
+    std::shared_ptr<const Snapshot> snapshot_;  // accessed with std::atomic_load/atomic_store
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::string path_;
+    std::string journal_path_;
+    std::vector<Change> pending_;           // changes not yet in the journal
+    std::size_t journal_entries_ = 0;
+    std::chrono::steady_clock::time_point last_change_;
+    bool compact_requested_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,188 @@
+#include "007_State/UserPreferences.h"
+#include "009_Services/FileWriter.h"
+
+#include <Wt/WLogger.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Changes are written once none came in for this long
+const std::chrono::seconds WRITE_IDLE(2);
+
+std::string escape(const std::string& text)
+{
+    std::string result;
+    for (char c : text) {
+        if (c == '\\') {
+            result += "\\\\";
+        } else if (c == '\t') {
+            result += "\\t";
+        } else if (c == '\n') {
+            result += "\\n";
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+std::string unescape(const std::string& text)
+{
+    std::string result;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '\\' && i + 1 < text.size()) {
+            const char c = text[++i];
+            result += c == 't' ? '\t' : (c == 'n' ? '\n' : c);
+        } else {
+            result += text[i];
+        }
+    }
+    return result;
+}
+
+}
+
+UserPreferences& UserPreferences::instance()
+{
+    static UserPreferences preferences;
+    return preferences;
+}
+
+UserPreferences::UserPreferences()
+{
+}
+
+UserPreferences::~UserPreferences()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void UserPreferences::load(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!path_.empty()) {
+        return;
+    }
+    path_ = path;
+
+    // One line per preference: user, key and value separated by tabs
+    std::ifstream file(path_);
+    std::string line;
+    std::size_t count = 0;
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields;
+        std::stringstream stream(line);
+        std::string field;
+        while (std::getline(stream, field, '\t')) {
+            fields.push_back(unescape(field));
+        }
+        if (fields.size() == 3) {
+            users_[fields[0]][fields[1]] = fields[2];
+            ++count;
+        }
+    }
+    Wt::log("info") << "UserPreferences: loaded " << count << " preferences from " << path_;
+
+    worker_ = std::thread(&UserPreferences::run, this);
+}
+
+std::string UserPreferences::value(const std::string& user, const std::string& key, const std::string& fallback) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto values = users_.find(user);
+    if (values == users_.end()) {
+        return fallback;
+    }
+    auto it = values->second.find(key);
+    return it != values->second.end() ? it->second : fallback;
+}
+
+int UserPreferences::value(const std::string& user, const std::string& key, int fallback) const
+{
+    const std::string text = value(user, key, std::string());
+    char* end = nullptr;
+    const long number = std::strtol(text.c_str(), &end, 10);
+    return text.empty() || *end != '\0' ? fallback : static_cast<int>(number);
+}
+
+void UserPreferences::set(const std::string& user, const std::string& key, const std::string& value)
+{
+    if (user.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string& current = users_[user][key];
+        if (current == value) {
+            return;
+        }
+        current = value;
+        dirty_ = true;
+        last_change_ = std::chrono::steady_clock::now();
+    }
+    wake_.notify_all();
+}
+
+void UserPreferences::flush()
+{
+    write();
+}
+
+void UserPreferences::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (!dirty_) {
+            wake_.wait(lock);
+            continue;
+        }
+        const auto due = last_change_ + WRITE_IDLE;
+        if (std::chrono::steady_clock::now() < due) {
+            wake_.wait_until(lock, due);
+            continue;
+        }
+        lock.unlock();
+        write();
+        lock.lock();
+    }
+    lock.unlock();
+    write();
+}
+
+void UserPreferences::write()
+{
+    std::string content;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!dirty_ || path_.empty()) {
+            return;
+        }
+        for (const auto& user : users_) {
+            for (const auto& entry : user.second) {
+                content += escape(user.first) + '\t' + escape(entry.first) + '\t' + escape(entry.second) + '\n';
+            }
+        }
+        path = path_;
+        dirty_ = false;
+    }
+
+    const std::string error = FileWriter::writeAtomically(path, {content}, false);
+    if (!error.empty()) {
+        Wt::log("error") << "UserPreferences: " << error;
+        std::lock_guard<std::mutex> lock(mutex_);
+        dirty_ = true;
+        last_change_ = std::chrono::steady_clock::now();
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*
+ * Process-wide per-user UI preferences (widths of drag bars, ...), shared by
+ * every session of a user.
+ *
+ * Reads and writes only touch memory. A background thread writes the whole
+ * store to its file once the changes have settled for a moment, so dragging a
+ * bar back and forth, in any number of sessions, costs one write. The file is
+ * replaced atomically and written once more when the process stops.
+ *
+ * Users are identified by their Wt::Auth::User id. Visitors who are not logged
+ * in have no preferences.
+ */
+class UserPreferences {
+public:
+    static UserPreferences& instance();
+
+    ~UserPreferences();
+
+    UserPreferences(const UserPreferences&) = delete;
+    UserPreferences& operator=(const UserPreferences&) = delete;
+
+    // Loads the preferences file and starts the writer, only the first call has an effect
+    void load(const std::string& path);
+
+    // Value of a key, fallback if the user has none
+    std::string value(const std::string& user, const std::string& key, const std::string& fallback = "") const;
+    int value(const std::string& user, const std::string& key, int fallback) const;
+
+    void set(const std::string& user, const std::string& key, const std::string& value);
+
+    // Writes the file now instead of in the background
+    void flush();
+
+private:
+    UserPreferences();
+
+    void run();
+    void write();
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::map<std::string, std::map<std::string, std::string>> users_;
+    std::string path_;
+    std::chrono::steady_clock::time_point last_change_;
+    bool dirty_ = false;
+    bool stopping_ = false;
+    std::thread worker_;
+};
@@ -1,5 +1,7 @@
 #include "008_ApplicationShell/SidebarLayout.h"
 #include "004_Theme/DarkModeToggle.h"
+#include "004_Theme/Theme.h"
+#include "009_Services/TemplateHotSwap.h"
 
 #include <Wt/WApplication.h>
 #include <Wt/WText.h>
@@ -7,6 +9,8 @@
 #include <Wt/WPushButton.h>
 #include <Wt/WTemplate.h>
 
+#include <algorithm>
+
 SidebarLayout::SidebarLayout(Session& session)
     : Wt::WTemplate(),
     session_(session)
@@ -16,50 +20,181 @@ SidebarLayout::SidebarLayout(Session& session)
 #endif
 
     setTemplateText(Wt::WString::tr("sidebar-layout-with-header"));
+    TemplateHotSwap::instance().watch(this);
 
     sidebar_ = this->bindWidget("sidebar", std::make_unique<Wt::WTemplate>(Wt::WString::tr("sidebar-content")));
     sidebar_->addFunction("tr", &Wt::WTemplate::Functions::tr);
+    TemplateHotSwap::instance().watch(sidebar_);
     auto dark_mode_toggle = sidebar_->bindWidget("dark-mode-toggle", std::make_unique<DarkModeToggle>(session_));
 
     sidebar_m_ = this->bindWidget("sidebar-mobile", std::make_unique<Wt::WTemplate>(Wt::WString::tr("sidebar-content")));
     sidebar_m_->addFunction("tr", &Wt::WTemplate::Functions::tr);
+    TemplateHotSwap::instance().watch(sidebar_m_);
     auto dark_mode_toggle_m = sidebar_m_->bindWidget("dark-mode-toggle", std::make_unique<DarkModeToggle>(session_));
 
     content_stack_ = this->bindWidget("content", std::make_unique<Wt::WStackedWidget>());
 
+    // Disconnected with this layout, which App replaces when the user logs in or out
+    wApp->internalPathChanged().connect(this, &SidebarLayout::internalPathChanged);
+
     // Content
-    auto wrapper = std::make_unique<Wt::WContainerWidget>();
-    auto button = wrapper->addNew<Wt::WPushButton>("Test Button");
-    addMenuItem("home", std::move(wrapper), "heroicon-home");
+    addMenuItem("home", [](const std::string&) {
+        auto wrapper = std::make_unique<Wt::WContainerWidget>();
+        wrapper->addNew<Wt::WPushButton>("Test Button");
+        return wrapper;
+    }, "heroicon-home");
 
 }
 
-void SidebarLayout::addMenuItem(std::string name, std::unique_ptr<Wt::WContainerWidget> content, std::string icon_tr_id)
+void SidebarLayout::addMenuItem(std::string name, std::unique_ptr<Wt::WContainerWidget> content, std::string icon_tr_id, std::string style_sheet_chunk)
 {
-    // Desktop menu
-    auto menu_item = sidebar_->bindWidget(name, std::make_unique<Wt::WAnchor>(Wt::WLink(Wt::LinkType::InternalPath, "/"+name), name));
+    Page* page = addPage(std::move(name), std::move(icon_tr_id), std::move(style_sheet_chunk));
+    page->content = content_stack_->addWidget(std::move(content));
+}
+
+void SidebarLayout::addMenuItem(std::string name, PageFactory factory, std::string icon_tr_id, std::string style_sheet_chunk, StateSaver save_state)
+{
+    Page* page = addPage(std::move(name), std::move(icon_tr_id), std::move(style_sheet_chunk));
+    page->factory = std::move(factory);
+    page->save_state = std::move(save_state);
+}
+
+void SidebarLayout::setPageCacheSize(std::size_t size)
+{
+    page_cache_size_ = size;
+    evict();
+}
+
+SidebarLayout::Page* SidebarLayout::addPage(std::string name, std::string icon_tr_id, std::string style_sheet_chunk)
+{
+    auto page = std::make_unique<Page>();
+    page->name = name;
+    page->style_sheet_chunk = std::move(style_sheet_chunk);
 
-    menu_item->insertWidget(0, std::make_unique<Wt::WTemplate>(Wt::WString::tr(icon_tr_id)));
+    // Desktop menu
+    page->menu_item = sidebar_->bindWidget(name, std::make_unique<Wt::WAnchor>(Wt::WLink(Wt::LinkType::InternalPath, "/"+name), name));
+    TemplateHotSwap::instance().watch(page->menu_item->insertNew<Wt::WTemplate>(0, Wt::WString::tr(icon_tr_id)));
     // Mobile Sidebar menu
-    auto menu_item_m = sidebar_m_->bindWidget(name, std::make_unique<Wt::WAnchor>(Wt::WLink(Wt::LinkType::InternalPath, "/"+name), name));
-    menu_item_m->insertWidget(0, std::make_unique<Wt::WTemplate>(Wt::WString::tr(icon_tr_id)));
-
-    auto menu_item_content = content_stack_->addWidget(std::move(content));
-    
-    wApp->internalPathChanged().connect([=](const std::string& path) {
-        if (path == "/"+name) {
-            content_stack_->setCurrentWidget(menu_item_content);
-            for(auto& item : selected_menu_items_) {
-                item->toggleStyleClass("!bg-surface-alt", false, false);
-                item->toggleStyleClass("!text-primary", false, false);
-            }
-            selected_menu_items_.clear();
-            selected_menu_items_.push_back(menu_item);
-            selected_menu_items_.push_back(menu_item_m);
-            for(auto& item : selected_menu_items_) {
-                item->toggleStyleClass("!bg-surface-alt", true, false);
-                item->toggleStyleClass("!text-primary", true, false);
-            }
+    page->menu_item_m = sidebar_m_->bindWidget(name, std::make_unique<Wt::WAnchor>(Wt::WLink(Wt::LinkType::InternalPath, "/"+name), name));
+    TemplateHotSwap::instance().watch(page->menu_item_m->insertNew<Wt::WTemplate>(0, Wt::WString::tr(icon_tr_id)));
+
+    Page* added = page.get();
+    routes_[name] = added;
+    pages_.push_back(std::move(page));
+    return added;
+}
+
+void SidebarLayout::setRouteHandler(const std::string& name, RouteHandler handler)
+{
+    auto it = routes_.find(name);
+    if (it != routes_.end()) {
+        it->second->route_handler = std::move(handler);
+    }
+}
+
+void SidebarLayout::render(Wt::WFlags<Wt::RenderFlag> flags)
+{
+    // A layout created after the session started has not seen the current path yet
+    if (!routed_) {
+        internalPathChanged(wApp->internalPath());
+    }
+    Wt::WTemplate::render(flags);
+}
+
+void SidebarLayout::internalPathChanged(const std::string& path)
+{
+    routed_ = true;
+
+    Page* page = nullptr;
+    std::string parameter;
+    const std::size_t begin = path.find_first_not_of('/');
+    if (begin == std::string::npos) {
+        // "/" is the first page
+        page = pages_.empty() ? nullptr : pages_.front().get();
+    } else {
+        const std::size_t end = path.find('/', begin);
+        auto it = routes_.find(path.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+        if (it != routes_.end()) {
+            page = it->second;
+            parameter = end == std::string::npos ? std::string() : path.substr(end + 1);
+        }
+        // Paths below a page only exist if the page handles them
+        if (page != nullptr && !parameter.empty() && !page->route_handler) {
+            page = nullptr;
+        }
+    }
+
+    select(page, path);
+    if (page != nullptr && page->route_handler) {
+        page->route_handler(parameter);
+    }
+}
+
+void SidebarLayout::select(Page* page, const std::string& path)
+{
+    if (page == nullptr) {
+        if (not_found_ == nullptr) {
+            not_found_ = content_stack_->addNew<Wt::WTemplate>(Wt::WString::tr("sidebar-page-not-found"));
+            TemplateHotSwap::instance().watch(not_found_);
+        }
+        not_found_->bindWidget("path", std::make_unique<Wt::WText>(Wt::WString::fromUTF8(path), Wt::TextFormat::Plain));
+        content_stack_->setCurrentWidget(not_found_);
+    } else {
+        if (!page->style_sheet_chunk.empty()) {
+            Theme::useStyleSheetChunk(page->style_sheet_chunk);
+        }
+        build(page);
+        content_stack_->setCurrentWidget(page->content);
+    }
+
+    // Only the menu items of the previous and the new page change
+    if (page != current_) {
+        highlight(current_, false);
+        highlight(page, true);
+        current_ = page;
+    }
+    evict();
+}
+
+void SidebarLayout::highlight(Page* page, bool selected)
+{
+    if (page == nullptr) {
+        return;
+    }
+    for (Wt::WAnchor* item : {page->menu_item, page->menu_item_m}) {
+        item->toggleStyleClass("!bg-surface-alt", selected, false);
+        item->toggleStyleClass("!text-primary", selected, false);
+    }
+}
+
+void SidebarLayout::build(Page* page)
+{
+    if (!page->factory) {
+        return;
+    }
+    if (page->content != nullptr) {
+        built_.splice(built_.begin(), built_, page->built_position);
+        return;
+    }
+
+    std::unique_ptr<Wt::WWidget> content = page->factory(page->state);
+    page->state.clear();
+    page->content = content.get();
+    content_stack_->addWidget(std::move(content));
+    built_.push_front(page);
+    page->built_position = built_.begin();
+}
+
+void SidebarLayout::evict()
+{
+    // The shown page is the most recently used one, it always stays
+    while (built_.size() > std::max<std::size_t>(page_cache_size_, 1)) {
+        Page* page = built_.back();
+        built_.pop_back();
+        if (page->save_state) {
+            page->state = page->save_state(page->content);
         }
-    });
-}
\ No newline at end of file
+        content_stack_->removeWidget(page->content);
+        page->content = nullptr;
+    }
+}
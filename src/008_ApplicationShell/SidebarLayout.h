@@ -6,20 +6,77 @@
 #include "002_Dbo/Session.h"
 #include <Wt/WAnchor.h>
 
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 class SidebarLayout : public Wt::WTemplate
 {
 public:
+    // Called when the internal path selects a page, parameter is what follows "/name/", empty for "/name"
+    using RouteHandler = std::function<void(const std::string& parameter)>;
+    // Builds the content of a page, state is what its StateSaver returned when it was last evicted, empty before
+    using PageFactory = std::function<std::unique_ptr<Wt::WWidget>(const std::string& state)>;
+    // Captures what a page needs to come back the way it was left, called right before its content is deleted
+    using StateSaver = std::function<std::string(Wt::WWidget* content)>;
+
     SidebarLayout(Session& session);
     
-    void addMenuItem(std::string name, std::unique_ptr<Wt::WContainerWidget> content, std::string icon_tr_id = "");
+    // style_sheet_chunk names the static/css/chunks stylesheet the page needs, linked on first visit
+    void addMenuItem(std::string name, std::unique_ptr<Wt::WContainerWidget> content, std::string icon_tr_id = "", std::string style_sheet_chunk = "");
+    // A page only built when it is first shown, and deleted again when more than the page cache size were built since
+    void addMenuItem(std::string name, PageFactory factory, std::string icon_tr_id = "", std::string style_sheet_chunk = "", StateSaver save_state = nullptr);
+
+    // How many of the pages added with a factory stay built, the shown one included
+    void setPageCacheSize(std::size_t size);
+
+    // Lets the page of name also answer the paths below it, "/name/<parameter>", which are not found otherwise
+    void setRouteHandler(const std::string& name, RouteHandler handler);
+
+protected:
+    void render(Wt::WFlags<Wt::RenderFlag> flags) override;
+
 private:
+    struct Page {
+        std::string name;
+        std::string style_sheet_chunk;
+        Wt::WWidget* content = nullptr;
+        Wt::WAnchor* menu_item = nullptr;
+        Wt::WAnchor* menu_item_m = nullptr;
+        RouteHandler route_handler;
+        PageFactory factory;                        // empty for pages added built, which are never evicted
+        StateSaver save_state;
+        std::string state;                          // saved on the last eviction
+        std::list<Page*>::iterator built_position;  // in built_, while content is set
+    };
+
+    Page* addPage(std::string name, std::string icon_tr_id, std::string style_sheet_chunk);
+
+    // The one listener of internalPathChanged, looks the first path segment up in routes_
+    void internalPathChanged(const std::string& path);
+    // Shows page, or the not found page for nullptr, and moves the highlight between the menu items
+    void select(Page* page, const std::string& path);
+    void highlight(Page* page, bool selected);
+    // Builds page if its content was not built or was evicted, and marks it most recently used
+    void build(Page* page);
+    void evict();
+
     Wt::WTemplate* sidebar_;
     Wt::WTemplate* sidebar_m_;
 
     Wt::WStackedWidget* content_stack_;
+    Wt::WTemplate* not_found_ = nullptr;
 
     Session& session_;
-    std::vector<Wt::WAnchor*> selected_menu_items_;
+    std::vector<std::unique_ptr<Page>> pages_;              // in menu order, the first one is the start page
+    std::unordered_map<std::string, Page*> routes_;         // by name, the first segment of the internal path
+    Page* current_ = nullptr;
+    std::list<Page*> built_;                                // pages built by their factory, most recently shown first
+    std::size_t page_cache_size_ = 4;
+    bool routed_ = false;
 };
 
 #endif // SIDEBARLAYOUT_H
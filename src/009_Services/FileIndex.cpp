@@ -0,0 +1,314 @@
+#include "009_Services/FileIndex.h"
+
+#include <Wt/WLogger.h>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+const std::uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO
+    | IN_ATTRIB | IN_DONT_FOLLOW | IN_ONLYDIR;
+
+// Events arriving within this window of each other are published as one update
+const int COALESCE_MS = 50;
+
+// Dependencies and hidden entries are never shown by the panels
+bool ignored(const char* name)
+{
+    return name[0] == '.' || std::strcmp(name, "node_modules") == 0;
+}
+
+std::int64_t mtimeNanoseconds(const struct stat& st)
+{
+    return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+std::string join(const std::string& directory, const std::string& name)
+{
+    return directory.empty() ? name : directory + "/" + name;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+std::vector<const FileIndex::File*> FileIndex::Snapshot::list(const std::string& directory,
+                                                              const std::string& extension) const
+{
+    const std::string prefix = directory.empty() ? "" : directory + "/";
+    auto it = std::lower_bound(files.begin(), files.end(), prefix, [](const File& file, const std::string& prefix) {
+        return file.path < prefix;
+    });
+
+    std::vector<const File*> result;
+    for (; it != files.end() && it->path.compare(0, prefix.size(), prefix) == 0; ++it) {
+        if (extension.empty() || endsWith(it->path, extension)) {
+            result.push_back(&*it);
+        }
+    }
+    return result;
+}
+
+FileIndex& FileIndex::instance()
+{
+    static FileIndex index;
+    return index;
+}
+
+FileIndex::FileIndex()
+    : snapshot_(std::make_shared<const Snapshot>())
+{
+}
+
+FileIndex::~FileIndex()
+{
+    if (worker_.joinable()) {
+        const std::uint64_t one = 1;
+        if (::write(wake_fd_, &one, sizeof(one)) < 0) {
+            Wt::log("error") << "FileIndex: failed to stop the watcher: " << std::strerror(errno);
+        }
+        worker_.join();
+    }
+    if (inotify_fd_ >= 0) {
+        ::close(inotify_fd_);
+    }
+    if (wake_fd_ >= 0) {
+        ::close(wake_fd_);
+    }
+}
+
+void FileIndex::start(const std::string& root)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (started_) {
+            return;
+        }
+        started_ = true;
+    }
+
+    root_ = root;
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotify_fd_ < 0 || wake_fd_ < 0) {
+        Wt::log("error") << "FileIndex: inotify unavailable, " << root << " is indexed once: " << std::strerror(errno);
+    }
+
+    scanDirectory("");
+    publish();
+    Wt::log("info") << "FileIndex: " << files_.size() << " files under " << root;
+
+    if (inotify_fd_ >= 0 && wake_fd_ >= 0) {
+        worker_ = std::thread(&FileIndex::run, this);
+    }
+}
+
+std::shared_ptr<const FileIndex::Snapshot> FileIndex::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return snapshot_;
+}
+
+int FileIndex::subscribe(Listener listener)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_[++next_listener_] = std::move(listener);
+    return next_listener_;
+}
+
+void FileIndex::unsubscribe(int id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.erase(id);
+}
+
+std::string FileIndex::absolute(const std::string& relative) const
+{
+    return relative.empty() ? root_ : root_ + "/" + relative;
+}
+
+void FileIndex::run()
+{
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Wt::log("error") << "FileIndex: poll failed: " << std::strerror(errno);
+            return;
+        }
+        if (fds[1].revents) {
+            return;
+        }
+
+        // Saves come as a burst of create, write and rename events
+        bool changed = false;
+        bool overflow = false;
+        do {
+            changed = readEvents(overflow) || changed;
+        } while (poll(fds, 1, COALESCE_MS) > 0);
+
+        if (overflow) {
+            // Events were lost, the only case that needs a full scan
+            Wt::log("error") << "FileIndex: inotify queue overflowed, rescanning " << root_;
+            for (const auto& watch : watches_) {
+                inotify_rm_watch(inotify_fd_, watch.first);
+            }
+            watches_.clear();
+            files_.clear();
+            scanDirectory("");
+            changed = true;
+        }
+        if (changed) {
+            publish();
+        }
+    }
+}
+
+bool FileIndex::readEvents(bool& overflow)
+{
+    alignas(inotify_event) char buffer[16 * 1024];
+    bool changed = false;
+
+    for (;;) {
+        const ssize_t length = ::read(inotify_fd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            return changed;
+        }
+
+        for (char* p = buffer; p < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                overflow = true;
+                continue;
+            }
+            auto watch = watches_.find(event->wd);
+            if (watch == watches_.end()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                watches_.erase(watch);
+                continue;
+            }
+            if (event->len == 0 || ignored(event->name)) {
+                continue;
+            }
+
+            const std::string relative = join(watch->second, event->name);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    scanDirectory(relative);
+                    changed = true;
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    removeDirectory(relative);
+                    changed = true;
+                }
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                changed = files_.erase(relative) > 0 || changed;
+            } else {
+                changed = updateFile(relative) || changed;
+            }
+        }
+    }
+}
+
+void FileIndex::scanDirectory(const std::string& relative)
+{
+    const std::string path = absolute(relative);
+    // Watched before listing, so a file created in between is not missed
+    if (inotify_fd_ >= 0) {
+        const int wd = inotify_add_watch(inotify_fd_, path.c_str(), WATCH_MASK);
+        if (wd >= 0) {
+            watches_[wd] = relative;
+        }
+    }
+
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (ignored(entry->d_name)) {
+            continue;
+        }
+        const std::string child = join(relative, entry->d_name);
+        struct stat st;
+        if (lstat(absolute(child).c_str(), &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            scanDirectory(child);
+        } else if (S_ISREG(st.st_mode)) {
+            files_[child] = File{child, static_cast<std::uintmax_t>(st.st_size), mtimeNanoseconds(st)};
+        }
+    }
+    closedir(dir);
+}
+
+void FileIndex::removeDirectory(const std::string& relative)
+{
+    const std::string prefix = relative + "/";
+    for (auto it = files_.lower_bound(prefix); it != files_.end() && it->first.compare(0, prefix.size(), prefix) == 0;) {
+        it = files_.erase(it);
+    }
+    // A moved directory keeps its watches, they would report under the old path
+    for (auto it = watches_.begin(); it != watches_.end();) {
+        if (it->second == relative || it->second.compare(0, prefix.size(), prefix) == 0) {
+            inotify_rm_watch(inotify_fd_, it->first);
+            it = watches_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool FileIndex::updateFile(const std::string& relative)
+{
+    struct stat st;
+    if (lstat(absolute(relative).c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return files_.erase(relative) > 0;
+    }
+    const File file{relative, static_cast<std::uintmax_t>(st.st_size), mtimeNanoseconds(st)};
+    auto it = files_.find(relative);
+    if (it != files_.end() && it->second.size == file.size && it->second.mtime == file.mtime) {
+        return false;
+    }
+    files_[relative] = file;
+    return true;
+}
+
+void FileIndex::publish()
+{
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->version = ++version_;
+    snapshot->root = root_;
+    snapshot->files.reserve(files_.size());
+    for (const auto& entry : files_) {
+        snapshot->files.push_back(entry.second);
+    }
+
+    std::map<int, Listener> listeners;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot_ = snapshot;
+        listeners = listeners_;
+    }
+    for (const auto& listener : listeners) {
+        listener.second(snapshot);
+    }
+}
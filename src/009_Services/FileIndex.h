@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Process-wide index of the files under a directory, kept current through inotify
+ *
+ * The tree is scanned once by start(), after that a worker thread applies the
+ * inotify events to the index, a new directory is scanned on its own, nothing is
+ * ever rescanned (unless the kernel's event queue overflowed). Bursts of events
+ * are coalesced into one update.
+ *
+ * Every update publishes a new immutable Snapshot with a higher version, readers
+ * keep the one they have for as long as they like. Listeners are called with the
+ * new snapshot on the worker thread, use Wt::WServer::post() to get back into a
+ * session.
+ */
+class FileIndex {
+public:
+    struct File {
+        std::string path;       ///< relative to the root, '/' separated
+        std::uintmax_t size = 0;
+        std::int64_t mtime = 0; ///< nanoseconds since the epoch, two saves within a second differ
+    };
+
+    struct Snapshot {
+        std::uint64_t version = 0;
+        std::string root;           ///< directory the paths are relative to
+        std::vector<File> files;    ///< sorted by path
+
+        /**
+         * @brief Files below a directory with a given extension
+         * @param directory Relative directory, "" for the whole tree
+         * @param extension Extension including the dot, "" for any
+         */
+        std::vector<const File*> list(const std::string& directory, const std::string& extension = "") const;
+    };
+
+    using Listener = std::function<void(std::shared_ptr<const Snapshot> snapshot)>;
+
+    static FileIndex& instance();
+
+    ~FileIndex();
+
+    FileIndex(const FileIndex&) = delete;
+    FileIndex& operator=(const FileIndex&) = delete;
+
+    /**
+     * @brief Scans a directory and starts watching it, only the first call has an effect
+     * @param root Directory to index
+     */
+    void start(const std::string& root);
+
+    /**
+     * @brief The current snapshot, empty until start() was called
+     */
+    std::shared_ptr<const Snapshot> snapshot() const;
+
+    /**
+     * @brief Registers a listener for new snapshots
+     * @return Id to pass to unsubscribe()
+     */
+    int subscribe(Listener listener);
+
+    void unsubscribe(int id);
+
+private:
+    FileIndex();
+
+    void run();
+    bool readEvents(bool& overflow);
+    void scanDirectory(const std::string& relative);
+    void removeDirectory(const std::string& relative);
+    bool updateFile(const std::string& relative);
+    void publish();
+    std::string absolute(const std::string& relative) const;
+
+    mutable std::mutex mutex_;
+    std::shared_ptr<const Snapshot> snapshot_;
+    std::map<int, Listener> listeners_;
+    int next_listener_ = 0;
+    bool started_ = false;
+
+    // Owned by the worker thread once started
+    std::string root_;
+    std::map<std::string, File> files_;
+    std::unordered_map<int, std::string> watches_;  ///< inotify watch descriptor to relative directory
+    std::uint64_t version_ = 0;
+    int inotify_fd_ = -1;
+    int wake_fd_ = -1;
+    std::thread worker_;
+};
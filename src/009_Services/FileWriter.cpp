@@ -0,0 +1,170 @@
+#include "009_Services/FileWriter.h"
+
+#include <Wt/WLogger.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+std::string systemError(const std::string& what, const std::string& path)
+{
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+bool writeAll(int fd, std::string_view content)
+{
+    std::size_t written = 0;
+    while (written < content.size()) {
+        const ssize_t n = ::write(fd, content.data() + written, content.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// The rename is only durable once the directory entry is on disk as well
+void syncDirectory(const std::string& path)
+{
+    const std::size_t slash = path.find_last_of('/');
+    const std::string dir = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+}
+
+}
+
+FileWriter& FileWriter::instance()
+{
+    static FileWriter writer;
+    return writer;
+}
+
+FileWriter::FileWriter()
+    : worker_(&FileWriter::run, this)
+{
+}
+
+FileWriter::~FileWriter()
+{
+    // Writes still queued are finished, they are saves the user asked for
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    worker_.join();
+}
+
+void FileWriter::write(const std::string& path, std::string content, Completion done, bool sync)
+{
+    auto owner = std::make_shared<const std::string>(std::move(content));
+    std::vector<std::string_view> parts{std::string_view(*owner)};
+    write(path, std::move(parts), std::move(owner), std::move(done), sync);
+}
+
+void FileWriter::write(const std::string& path, std::vector<std::string_view> parts, std::shared_ptr<const void> owner,
+                       Completion done, bool sync)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = jobs_.find(path);
+        if (it == jobs_.end()) {
+            it = jobs_.emplace(path, Job()).first;
+            order_.push_back(path);
+        }
+        Job& job = it->second;
+        job.parts = std::move(parts);
+        job.owner = std::move(owner);
+        job.sync = job.sync || sync;
+        if (done) {
+            job.completions.push_back(std::move(done));
+        }
+    }
+    wake_.notify_one();
+}
+
+void FileWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this] { return stopping_ || !order_.empty(); });
+        if (order_.empty()) {
+            return;
+        }
+
+        const std::string path = std::move(order_.front());
+        order_.pop_front();
+        Job job = std::move(jobs_[path]);
+        jobs_.erase(path);
+
+        lock.unlock();
+        const std::string error = writeAtomically(path, job.parts, job.sync);
+        if (error.empty()) {
+            std::size_t bytes = 0;
+            for (std::string_view part : job.parts) {
+                bytes += part.size();
+            }
+            Wt::log("info") << "FileWriter: " << path << " saved (" << bytes << " bytes)";
+        } else {
+            Wt::log("error") << "FileWriter: " << error;
+        }
+        for (const Completion& done : job.completions) {
+            done(error);
+        }
+        lock.lock();
+    }
+}
+
+std::string FileWriter::writeAtomically(const std::string& path, const std::vector<std::string_view>& parts, bool sync)
+{
+    std::string temp_path = path + ".XXXXXX";
+    const int fd = ::mkstemp(&temp_path[0]);
+    if (fd < 0) {
+        return systemError("Failed to create a temporary file for", path);
+    }
+
+    // mkstemp creates the file 0600, keep the mode of the file being replaced
+    struct stat st;
+    ::fchmod(fd, ::stat(path.c_str(), &st) == 0 ? (st.st_mode & 07777) : 0644);
+
+    std::string error;
+    for (std::string_view part : parts) {
+        if (!writeAll(fd, part)) {
+            error = systemError("Failed to write", temp_path);
+            break;
+        }
+    }
+    if (error.empty() && sync && ::fsync(fd) != 0) {
+        error = systemError("Failed to sync", temp_path);
+    }
+    if (::close(fd) != 0 && error.empty()) {
+        error = systemError("Failed to close", temp_path);
+    }
+    if (error.empty() && std::rename(temp_path.c_str(), path.c_str()) != 0) {
+        error = systemError("Failed to replace", path);
+    }
+
+    if (!error.empty()) {
+        std::remove(temp_path.c_str());
+        return error;
+    }
+    if (sync) {
+        syncDirectory(path);
+    }
+    return error;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Process-wide background writer for files edited in the browser
+ *
+ * Writes run on one worker thread, never on a session's thread. Each write goes
+ * to a temporary file in the same directory which is then renamed over the
+ * target, so a crash mid-write leaves the old file intact. A write queued for a
+ * path that already has one waiting replaces its content, both callers are then
+ * notified when the newest content is on disk.
+ *
+ * Completions run on the worker thread, use Wt::WServer::post() to get back
+ * into a session.
+ */
+class FileWriter {
+public:
+    /**
+     * @brief Called once the write finished
+     * @param error Empty on success, the reason of the failure otherwise
+     */
+    using Completion = std::function<void(const std::string& error)>;
+
+    static FileWriter& instance();
+
+    ~FileWriter();
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    /**
+     * @brief Queues a write
+     * @param path File to replace
+     * @param content New content
+     * @param done Completion, may be empty
+     * @param sync Whether to fsync the file and its directory before reporting success
+     */
+    void write(const std::string& path, std::string content, Completion done = nullptr, bool sync = false);
+
+    /**
+     * @brief Queues a write of content held elsewhere, without copying it
+     * @param path File to replace
+     * @param parts Content, written one part after the other
+     * @param owner Keeps the memory of parts alive until the write is done
+     * @param done Completion, may be empty
+     * @param sync Whether to fsync the file and its directory before reporting success
+     */
+    void write(const std::string& path, std::vector<std::string_view> parts, std::shared_ptr<const void> owner,
+               Completion done = nullptr, bool sync = false);
+
+    /**
+     * @brief Replaces a file on the calling thread, for callers already running in the background
+     * @param path File to replace
+     * @param parts Content, written one part after the other
+     * @param sync Whether to fsync the file and its directory
+     * @return Empty on success, the reason of the failure otherwise
+     */
+    static std::string writeAtomically(const std::string& path, const std::vector<std::string_view>& parts, bool sync);
+
+private:
+    struct Job {
+        std::vector<std::string_view> parts;
+        std::shared_ptr<const void> owner;
+        bool sync = false;
+        std::vector<Completion> completions;
+    };
+
+    FileWriter();
+
+    void run();
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::string> order_;                 ///< paths in the order they were first queued
+    std::unordered_map<std::string, Job> jobs_;     ///< pending job per path
+    bool stopping_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,385 @@
+#include "009_Services/TailwindBuilder.h"
+
+#include "004_Theme/CssPrune.h"
+#include "004_Theme/Theme.h"
+#include "009_Services/FileWriter.h"
+
+#include <Wt/WApplication.h>
+#include <Wt/WLogger.h>
+#include <Wt/WServer.h>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+extern char** environ;
+
+namespace {
+
+const std::string TAILWIND = "tailwind";                    // holds input.css, relative to static/0_stylus
+const std::string TEMPLATES = "xml";                        // scanned by input.css through @source
+const std::string OUTPUT_CSS = "/static/css/tailwind.minify.css";
+const std::string PRUNED_CSS = "/static/css/tailwind.pruned.css";
+const std::string CHUNKS_DIR = "/static/css/chunks/";
+const std::string WORK_DIR = "/cache/tailwind/";           // CLI output and log, not served
+
+// Enough of the CLI's output to tell why a build failed
+const std::size_t ERROR_TAIL = 400;
+
+std::string readFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    std::stringstream content;
+    content << file.rdbuf();
+    return content.str();
+}
+
+}
+
+TailwindBuilder& TailwindBuilder::instance()
+{
+    static TailwindBuilder builder;
+    return builder;
+}
+
+TailwindBuilder::TailwindBuilder()
+{
+}
+
+TailwindBuilder::~TailwindBuilder()
+{
+    if (subscription_ >= 0) {
+        FileIndex::instance().unsubscribe(subscription_);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        if (child_ > 0) {
+            ::kill(-child_, SIGTERM);
+        }
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void TailwindBuilder::start(const std::string& docRoot)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    doc_root_ = docRoot;
+
+    // Subscribing under the lock, the listener compares against the snapshot read here
+    subscription_ = FileIndex::instance().subscribe([this](std::shared_ptr<const FileIndex::Snapshot> snapshot) {
+        filesChanged(std::move(snapshot));
+    });
+    const auto snapshot = FileIndex::instance().snapshot();
+    for (const FileIndex::File* file : snapshot->list(TEMPLATES, ".xml")) {
+        sources_[file->path] = *file;
+    }
+    for (const FileIndex::File* file : snapshot->list(TAILWIND, "input.css")) {
+        sources_[file->path] = *file;
+    }
+
+    worker_ = std::thread(&TailwindBuilder::run, this);
+}
+
+void TailwindBuilder::rebuild()
+{
+    queue();
+}
+
+void TailwindBuilder::setDebounce(std::chrono::milliseconds debounce)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    debounce_ = debounce;
+}
+
+TailwindBuilder::Stats TailwindBuilder::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+int TailwindBuilder::subscribe(Listener listener)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int id = next_listener_++;
+    listeners_[id] = std::move(listener);
+    return id;
+}
+
+void TailwindBuilder::unsubscribe(int id)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    listeners_.erase(id);
+}
+
+void TailwindBuilder::filesChanged(std::shared_ptr<const FileIndex::Snapshot> snapshot)
+{
+    std::map<std::string, FileIndex::File> sources;
+    for (const FileIndex::File* file : snapshot->list(TEMPLATES, ".xml")) {
+        sources[file->path] = *file;
+    }
+    for (const FileIndex::File* file : snapshot->list(TAILWIND, "input.css")) {
+        sources[file->path] = *file;
+    }
+
+    bool changed = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        changed = sources.size() != sources_.size();
+        for (auto it = sources.begin(); !changed && it != sources.end(); ++it) {
+            auto seen = sources_.find(it->first);
+            changed = seen == sources_.end() || seen->second.size != it->second.size
+                || seen->second.mtime != it->second.mtime;
+        }
+        sources_ = std::move(sources);
+    }
+    if (changed) {
+        queue();
+    }
+}
+
+void TailwindBuilder::queue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = true;
+        last_change_ = std::chrono::steady_clock::now();
+        if (stats_.state == State::Building) {
+            // The running build is already out of date
+            stats_.queued = true;
+            if (child_ > 0) {
+                ::kill(-child_, SIGTERM);
+            }
+        } else {
+            stats_.state = State::Waiting;
+        }
+    }
+    wake_.notify_all();
+    notify();
+}
+
+void TailwindBuilder::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (!pending_) {
+            wake_.wait(lock);
+            continue;
+        }
+
+        const auto due = last_change_ + debounce_;
+        if (std::chrono::steady_clock::now() < due) {
+            wake_.wait_until(lock, due);
+            continue;
+        }
+
+        pending_ = false;
+        stats_.state = State::Building;
+        stats_.queued = false;
+        lock.unlock();
+        notify();
+
+        const auto started = std::chrono::steady_clock::now();
+        std::string css;
+        std::string error;
+        std::size_t size = 0;
+        bool ok = build(css, error);
+
+        lock.lock();
+        const bool cancelled = stats_.queued || stop_;
+        lock.unlock();
+        if (ok && !cancelled) {
+            ok = publish(css, size, error);
+        }
+        lock.lock();
+
+        const auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+        if (cancelled) {
+            ++stats_.cancelled;
+        } else if (ok) {
+            ++stats_.builds;
+            stats_.last_duration = duration;
+            stats_.last_error.clear();
+            stats_.last_size = size;
+            Wt::log("info") << "TailwindBuilder: built " << size << " bytes of pruned CSS in " << duration.count() << " ms";
+        } else {
+            ++stats_.failures;
+            stats_.last_duration = duration;
+            stats_.last_error = error;
+            Wt::log("error") << "TailwindBuilder: build failed: " << error;
+        }
+        stats_.queued = false;
+        stats_.state = pending_ ? State::Waiting : State::Idle;
+
+        lock.unlock();
+        notify();
+        lock.lock();
+    }
+}
+
+// Runs the Tailwind CLI from the tailwind directory, the way `npm run generate` does
+bool TailwindBuilder::build(std::string& css, std::string& error)
+{
+    const std::string directory = doc_root_ + "/static/0_stylus/tailwind";
+    const std::string output = doc_root_ + WORK_DIR + "partial.css";
+    const std::string log = doc_root_ + WORK_DIR + "build.log";
+    std::error_code ec;
+    std::filesystem::create_directories(doc_root_ + WORK_DIR, ec);
+
+    // The paths are positional parameters of the script, nothing is quoted
+    const char* argv[] = {
+        "/bin/sh", "-c", "cd \"$0\" && exec npx @tailwindcss/cli -i ./input.css -o \"$1\" --minify",
+        directory.c_str(), output.c_str(), nullptr
+    };
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO);
+
+    // In a group of its own, so cancelling also stops the node processes npx starts
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (stats_.queued || stop_) {
+        error = "cancelled";
+        return false;
+    }
+    pid_t pid = -1;
+    const int spawned = posix_spawn(&pid, argv[0], &actions, &attributes, const_cast<char* const*>(argv), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    if (spawned != 0) {
+        error = std::string("cannot start the Tailwind CLI: ") + std::strerror(spawned);
+        return false;
+    }
+    child_ = pid;
+    lock.unlock();
+
+    int status = 0;
+    while (::waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+    }
+
+    lock.lock();
+    child_ = -1;
+    lock.unlock();
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        const std::string messages = readFile(log);
+        error = WIFSIGNALED(status) ? "cancelled"
+            : messages.size() > ERROR_TAIL ? messages.substr(messages.size() - ERROR_TAIL) : messages;
+        std::filesystem::remove(output, ec);
+        return false;
+    }
+
+    css = readFile(output);
+    std::filesystem::remove(output, ec);
+    if (css.empty()) {
+        error = "the Tailwind CLI wrote no output";
+        return false;
+    }
+    return true;
+}
+
+// Prunes and splits the build like the prune-css target, writes every output
+// and swaps the chunks of every live session
+bool TailwindBuilder::publish(const std::string& css, std::size_t& size, std::string& error)
+{
+    const Css::PruneSpec spec = Css::projectPruneSpec(doc_root_);
+    Css::PruneReport report;
+    const std::vector<Css::Rule> rules = Css::prune(Css::parse(css), spec.sources, report);
+    if (!report.missingSources.empty()) {
+        // Pruning without them would drop the classes only they use
+        error = "cannot read " + report.missingSources.front() + ", the stylesheet is split along the source tree";
+        return false;
+    }
+    const std::string pruned = Css::serialize(rules);
+    const std::vector<std::string> chunks = Css::splitChunks(rules, spec.chunks);
+    size = pruned.size();
+
+    // Saves that do not change a class leave the sessions alone
+    bool changed = readFile(doc_root_ + PRUNED_CSS) != pruned;
+    for (std::size_t i = 0; i < chunks.size(); ++i) {
+        changed = changed || readFile(doc_root_ + CHUNKS_DIR + spec.chunks[i].name + ".css") != chunks[i];
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(doc_root_ + CHUNKS_DIR, ec);
+    error = FileWriter::writeAtomically(doc_root_ + OUTPUT_CSS, {css}, false);
+    if (error.empty() && changed) {
+        error = FileWriter::writeAtomically(doc_root_ + PRUNED_CSS, {pruned}, false);
+    }
+    for (std::size_t i = 0; error.empty() && changed && i < chunks.size(); ++i) {
+        error = FileWriter::writeAtomically(doc_root_ + CHUNKS_DIR + spec.chunks[i].name + ".css", {chunks[i]}, false);
+    }
+    if (!error.empty()) {
+        return false;
+    }
+    if (!changed) {
+        return true;
+    }
+
+    Theme::publishStyleSheetChunks();
+    std::uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation = ++generation_;
+    }
+
+    auto server = Wt::WServer::instance();
+    if (!server) {
+        return true;
+    }
+
+    // A session with an older swap still queued skips it, the newest one
+    // links the chunks as they are now. Every session has server push enabled
+    // (see App), triggerUpdate() sends the new links without waiting for a request.
+    server->postAll([this, generation]() {
+        auto* app = Wt::WApplication::instance();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!app || generation != generation_) {
+                return;
+            }
+        }
+        if (auto theme = std::dynamic_pointer_cast<const Theme>(app->theme())) {
+            theme->updateStyleSheetChunks();
+            app->triggerUpdate();
+        }
+    });
+    return true;
+}
+
+void TailwindBuilder::notify()
+{
+    std::map<int, Listener> listeners;
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        listeners = listeners_;
+        stats = stats_;
+    }
+    for (const auto& listener : listeners) {
+        listener.second(stats);
+    }
+}
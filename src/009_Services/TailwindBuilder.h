@@ -0,0 +1,114 @@
+#pragma once
+
+#include "009_Services/FileIndex.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * @brief Process-wide background rebuild of the Tailwind stylesheet
+ *
+ * Follows static/0_stylus/tailwind/input.css and the XML templates it takes
+ * its classes from through the FileIndex. Edits are debounced, then the
+ * Tailwind CLI runs on a worker thread, one build at a time. An edit arriving
+ * while a build runs cancels it, the next build starts once the edits are quiet
+ * again, so a burst of saves costs one finished build.
+ *
+ * The output replaces static/css/tailwind.minify.css and goes through the same
+ * prune and chunk split as the prune-css target (see Css::projectPruneSpec()),
+ * replacing static/css/tailwind.pruned.css and the chunks in static/css/chunks/.
+ * Every file is written atomically. Theme then hands out the new chunk versions,
+ * and every live session swaps the chunks it links for them right away: App
+ * attaches each session to TemplateHotSwap, which enables server push. The CLI's output
+ * and log stay in cache/tailwind/, outside of what the server makes public.
+ *
+ * Listeners are called with the new Stats on the worker thread, use
+ * Wt::WServer::post() to get back into a session.
+ */
+class TailwindBuilder {
+public:
+    enum class State { Idle, Waiting, Building };
+
+    struct Stats {
+        State state = State::Idle;
+        bool queued = false;            ///< an edit arrived during the running build
+        std::uint64_t builds = 0;       ///< finished successfully
+        std::uint64_t failures = 0;
+        std::uint64_t cancelled = 0;
+        std::chrono::milliseconds last_duration{0};
+        std::string last_error;         ///< empty if the last build succeeded
+        std::size_t last_size = 0;      ///< bytes of the pruned stylesheet of the last build
+    };
+
+    using Listener = std::function<void(const Stats& stats)>;
+
+    static TailwindBuilder& instance();
+
+    ~TailwindBuilder();
+
+    TailwindBuilder(const TailwindBuilder&) = delete;
+    TailwindBuilder& operator=(const TailwindBuilder&) = delete;
+
+    /**
+     * @brief Starts following the Tailwind sources, only the first call has an effect
+     * @param docRoot Document root holding static/0_stylus and static/css
+     *
+     * Call after FileIndex::start() on static/0_stylus.
+     */
+    void start(const std::string& docRoot);
+
+    /**
+     * @brief Queues a build as if input.css was edited
+     */
+    void rebuild();
+
+    /**
+     * @brief How long the sources have to be quiet before a build starts
+     */
+    void setDebounce(std::chrono::milliseconds debounce);
+
+    Stats stats() const;
+
+    /**
+     * @brief Registers a listener for changes of the stats
+     * @return Id to pass to unsubscribe()
+     */
+    int subscribe(Listener listener);
+
+    void unsubscribe(int id);
+
+private:
+    TailwindBuilder();
+
+    void filesChanged(std::shared_ptr<const FileIndex::Snapshot> snapshot);
+    void queue();
+    void run();
+    bool build(std::string& css, std::string& error);
+    bool publish(const std::string& css, std::size_t& size, std::string& error);
+    void notify();
+
+    std::string doc_root_;
+    int subscription_ = -1;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    Stats stats_;
+    std::map<std::string, FileIndex::File> sources_;    ///< as last seen by the listener
+    std::map<int, Listener> listeners_;
+    int next_listener_ = 0;
+    std::chrono::steady_clock::time_point last_change_;
+    std::chrono::milliseconds debounce_{500};
+    bool pending_ = false;
+    bool started_ = false;
+    bool stop_ = false;
+    int child_ = -1;                                    ///< process group of the running build
+    std::uint64_t generation_ = 0;                      ///< of the newest published build
+    std::thread worker_;
+};
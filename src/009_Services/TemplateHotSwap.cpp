@@ -0,0 +1,414 @@
+#include "009_Services/TemplateHotSwap.h"
+
+#include "004_Theme/Theme.h"
+
+#include <Wt/WApplication.h>
+#include <Wt/WLogger.h>
+#include <Wt/WServer.h>
+#include <Wt/WTemplate.h>
+#include <tinyxml2.h>
+
+#include <sys/stat.h>
+
+namespace {
+
+// Continuous saving must not hold the sessions back forever
+const std::chrono::milliseconds MAX_DELAY(1000);
+
+// The theme reads its class lists from this bundle
+const char* CLASS_LIST_BUNDLE = "General_components.xml";
+
+// Sessions posted to at once, and the pause before the next ones, so a batch
+// does not queue work for every session on the server's threads at the same time
+const std::size_t POST_BATCH = 32;
+const std::chrono::milliseconds POST_PAUSE(20);
+
+std::uint32_t fnv1a(const char* text)
+{
+    std::uint32_t hash = 2166136261u;
+    for (; *text; ++text) {
+        hash ^= static_cast<unsigned char>(*text);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix)
+{
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Ids of the messages a template text includes with ${tr:id} or ${block:id ...}
+void collectIncludes(const std::string& text, std::set<std::string>& ids)
+{
+    for (const std::string function : {"${tr:", "${block:"}) {
+        for (std::size_t at = text.find(function); at != std::string::npos; at = text.find(function, at)) {
+            at += function.size();
+            const std::size_t end = text.find_first_of("} \t\r\n", at);
+            if (end != std::string::npos && end > at) {
+                ids.insert(text.substr(at, end - at));
+            }
+        }
+    }
+}
+
+}
+
+TemplateHotSwap& TemplateHotSwap::instance()
+{
+    static TemplateHotSwap hotSwap;
+    return hotSwap;
+}
+
+TemplateHotSwap::TemplateHotSwap()
+{
+}
+
+TemplateHotSwap::~TemplateHotSwap()
+{
+    if (subscription_ >= 0) {
+        FileIndex::instance().unsubscribe(subscription_);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+void TemplateHotSwap::start(const std::string& directory)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    directory_ = directory;
+
+    // Subscribing first, under the lock, means no snapshot falls between the
+    // one read here and the first one the listener compares against it
+    subscription_ = FileIndex::instance().subscribe([this](std::shared_ptr<const FileIndex::Snapshot> snapshot) {
+        filesChanged(std::move(snapshot));
+    });
+
+    const auto snapshot = FileIndex::instance().snapshot();
+    root_ = snapshot->root;
+    for (const FileIndex::File* file : snapshot->list(directory_, ".xml")) {
+        files_[file->path] = *file;
+        parse(root_ + "/" + file->path, bundles_[file->path]);
+    }
+    Wt::log("info") << "TemplateHotSwap: following " << bundles_.size() << " bundles in " << root_ << "/" << directory_;
+
+    worker_ = std::thread(&TemplateHotSwap::run, this);
+}
+
+void TemplateHotSwap::attach()
+{
+    auto app = Wt::WApplication::instance();
+    if (!app) {
+        return;
+    }
+    bool attached = false;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        attached = sessions_.emplace(app->sessionId(), Session()).second;
+    }
+    if (attached) {
+        app->enableUpdates(true);
+    }
+}
+
+void TemplateHotSwap::detach()
+{
+    auto app = Wt::WApplication::instance();
+    if (!app) {
+        return;
+    }
+    bool detached = false;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        detached = sessions_.erase(app->sessionId()) > 0;
+    }
+    if (detached) {
+        app->enableUpdates(false);
+    }
+}
+
+void TemplateHotSwap::watch(Wt::WTemplate* widget)
+{
+    auto app = Wt::WApplication::instance();
+    const std::string& id = widget->templateText().key();
+    if (!app || id.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(sessions_mutex_);
+    auto session = sessions_.find(app->sessionId());
+    if (session == sessions_.end()) {
+        return;
+    }
+    // Rebuilt widgets register the same ids again, drop the ones already deleted
+    auto& templates = session->second.templates;
+    auto range = templates.equal_range(id);
+    for (auto it = range.first; it != range.second;) {
+        it = it->second ? std::next(it) : templates.erase(it);
+    }
+    templates.emplace(id, Wt::Core::observing_ptr<Wt::WTemplate>(widget));
+}
+
+void TemplateHotSwap::setDebounce(std::chrono::milliseconds debounce)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    debounce_ = debounce;
+}
+
+void TemplateHotSwap::filesChanged(std::shared_ptr<const FileIndex::Snapshot> snapshot)
+{
+    std::map<std::string, FileIndex::File> files;
+    for (const FileIndex::File* file : snapshot->list(directory_, ".xml")) {
+        files[file->path] = *file;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::set<std::string> changed;
+    for (const auto& entry : files) {
+        auto it = files_.find(entry.first);
+        if (it == files_.end() || it->second.size != entry.second.size || it->second.mtime != entry.second.mtime) {
+            changed.insert(entry.first);
+        }
+    }
+    for (const auto& entry : files_) {
+        if (!files.count(entry.first)) {
+            changed.insert(entry.first);
+        }
+    }
+    files_ = std::move(files);
+    if (changed.empty()) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (pending_.empty()) {
+        first_change_ = now;
+    }
+    last_change_ = now;
+    pending_.insert(changed.begin(), changed.end());
+    wake_.notify_all();
+}
+
+void TemplateHotSwap::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (pending_.empty()) {
+            wake_.wait(lock);
+            continue;
+        }
+
+        const auto due = std::min(last_change_ + debounce_, first_change_ + MAX_DELAY);
+        if (std::chrono::steady_clock::now() < due) {
+            wake_.wait_until(lock, due);
+            continue;
+        }
+
+        std::set<std::string> paths;
+        paths.swap(pending_);
+        lock.unlock();
+
+        bool classLists = false;
+        for (const std::string& path : paths) {
+            classLists = classLists || endsWith(path, CLASS_LIST_BUNDLE);
+        }
+        const std::set<std::string> ids = reparse(paths);
+        if (!ids.empty()) {
+            broadcast(includers(ids), classLists);
+        }
+
+        lock.lock();
+    }
+}
+
+// Parses each changed bundle once and returns the ids whose message is new, gone or different
+std::set<std::string> TemplateHotSwap::reparse(const std::set<std::string>& paths)
+{
+    std::set<std::string> ids;
+    for (const std::string& path : paths) {
+        // A removed bundle parses as empty, all of its messages are gone
+        const std::string file = root_ + "/" + path;
+        struct stat st;
+        Messages messages;
+        if (::stat(file.c_str(), &st) == 0 && !parse(file, messages)) {
+            // A half written or broken file keeps the sessions on the last good parse
+            Wt::log("error") << "TemplateHotSwap: cannot parse " << path << ", keeping the previous version";
+            continue;
+        }
+
+        Messages& previous = bundles_[path];
+        for (const auto& message : messages) {
+            auto it = previous.find(message.first);
+            if (it == previous.end() || it->second.hash != message.second.hash) {
+                ids.insert(message.first);
+            }
+        }
+        for (const auto& message : previous) {
+            if (!messages.count(message.first)) {
+                ids.insert(message.first);
+            }
+        }
+        if (messages.empty()) {
+            bundles_.erase(path);
+        } else {
+            previous = std::move(messages);
+        }
+    }
+    return ids;
+}
+
+// The changed ids and, repeatedly, the messages including any of them
+std::set<std::string> TemplateHotSwap::includers(std::set<std::string> ids) const
+{
+    bool grown = true;
+    while (grown) {
+        grown = false;
+        for (const auto& bundle : bundles_) {
+            for (const auto& message : bundle.second) {
+                if (ids.count(message.first)) {
+                    continue;
+                }
+                for (const std::string& included : message.second.includes) {
+                    if (ids.count(included)) {
+                        ids.insert(message.first);
+                        grown = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return ids;
+}
+
+void TemplateHotSwap::broadcast(const std::set<std::string>& ids, bool classLists)
+{
+    auto server = Wt::WServer::instance();
+    if (!server) {
+        return;
+    }
+
+    if (classLists) {
+        Theme::invalidateClassLists();
+    }
+
+    const std::uint64_t generation = generation_.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+    // A session whose previous post has not run yet already has one queued, it
+    // picks up these ids as well
+    std::vector<std::string> post;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (auto& entry : sessions_) {
+            Session& session = entry.second;
+            if (session.changed.empty()) {
+                post.push_back(entry.first);
+            }
+            session.changed.insert(ids.begin(), ids.end());
+            session.class_lists = session.class_lists || classLists;
+        }
+    }
+    Wt::log("info") << "TemplateHotSwap: " << ids.size() << " messages changed, updating "
+                    << post.size() << " sessions (batch " << generation << ")";
+
+    for (std::size_t i = 0; i < post.size(); ++i) {
+        if (i > 0 && i % POST_BATCH == 0) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (wake_.wait_for(lock, POST_PAUSE, [this]() { return stop_; })) {
+                return;
+            }
+        }
+        const std::string sessionId = post[i];
+        server->post(sessionId, [this, sessionId]() {
+            update(sessionId);
+        });
+    }
+}
+
+// Runs in the session, re-renders its watched templates of the changed ids
+void TemplateHotSwap::update(const std::string& sessionId)
+{
+    auto app = Wt::WApplication::instance();
+    if (!app) {
+        return;
+    }
+
+    std::set<std::string> ids;
+    bool classLists = false;
+    std::vector<Wt::WTemplate*> templates;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        auto session = sessions_.find(sessionId);
+        if (session == sessions_.end()) {
+            return;
+        }
+        ids.swap(session->second.changed);
+        classLists = session->second.class_lists;
+        session->second.class_lists = false;
+
+        auto& watched = session->second.templates;
+        for (const std::string& id : ids) {
+            auto range = watched.equal_range(id);
+            for (auto it = range.first; it != range.second;) {
+                // A template may have been given another text since it was watched
+                if (it->second && it->second->templateText().key() == id) {
+                    templates.push_back(it->second.get());
+                    ++it;
+                } else {
+                    it = watched.erase(it);
+                }
+            }
+        }
+    }
+
+    // The one reload of the bundles, the theme re-resolves its class lists from it
+    app->messageResourceBundle().refresh();
+    if (classLists) {
+        if (auto theme = std::dynamic_pointer_cast<const Theme>(app->theme())) {
+            theme->useReloadedClassLists();
+        }
+    }
+
+    for (Wt::WTemplate* widget : templates) {
+        widget->setTemplateText(Wt::WString::tr(widget->templateText().key()));
+    }
+    if (!templates.empty()) {
+        app->triggerUpdate();
+    }
+}
+
+bool TemplateHotSwap::parse(const std::string& path, Messages& messages)
+{
+    tinyxml2::XMLDocument document;
+    if (document.LoadFile(path.c_str()) != tinyxml2::XML_SUCCESS) {
+        return false;
+    }
+    const tinyxml2::XMLElement* root = document.RootElement();
+    if (!root || std::string(root->Name()) != "messages") {
+        return false;
+    }
+
+    for (const tinyxml2::XMLElement* message = root->FirstChildElement("message"); message;
+         message = message->NextSiblingElement("message")) {
+        const char* id = message->Attribute("id");
+        if (!id) {
+            continue;
+        }
+        tinyxml2::XMLPrinter printer(nullptr, true);
+        message->Accept(&printer);
+        Message& parsed = messages[id];
+        parsed.hash = fnv1a(printer.CStr());
+        collectIncludes(printer.CStr(), parsed.includes);
+    }
+    return true;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "009_Services/FileIndex.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <Wt/Core/observing_ptr.hpp>
+
+namespace Wt {
+    class WTemplate;
+}
+
+/**
+ * @brief Pushes changed XML message bundles to every live session
+ *
+ * Follows the bundle files through the FileIndex. When one changes it is
+ * re-parsed once, on a worker thread, and its messages are compared with the
+ * previous parse. Only if a message was added, removed or changed is anything
+ * sent, to every session that attach()ed itself, which App does for each one.
+ *
+ * Each attached session keeps a registry of the WTemplates it watch()es, by
+ * the message id of their template text. A batch reloads the session's bundles
+ * once and re-renders just the templates of the changed ids, and of the
+ * messages that include a changed one through ${tr:...} or ${block:...}.
+ *
+ * Saves are batched: a batch is sent once the bundles were quiet for the
+ * debounce interval (or at the latest after a second of constant changes), so a
+ * burst of saves across any number of bundles costs one post per session. The
+ * posts go out a few sessions at a time. A session that has not run its last
+ * post yet gets no new one, the ids pile up until it does.
+ */
+class TemplateHotSwap {
+public:
+    static TemplateHotSwap& instance();
+
+    ~TemplateHotSwap();
+
+    TemplateHotSwap(const TemplateHotSwap&) = delete;
+    TemplateHotSwap& operator=(const TemplateHotSwap&) = delete;
+
+    /**
+     * @brief Parses the bundles once and starts following them, only the first call has an effect
+     * @param directory Directory of the bundles relative to the FileIndex root
+     *
+     * Call after FileIndex::start().
+     */
+    void start(const std::string& directory);
+
+    /**
+     * @brief Sends changed templates to the current session from now on
+     *
+     * Enables server push for the session, for as long as it stays attached.
+     * Call again after detach() to resume.
+     */
+    void attach();
+
+    /**
+     * @brief Stops sending changed templates to the current session
+     */
+    void detach();
+
+    /**
+     * @brief Re-renders the template when the message of its template text changes
+     *
+     * No-op when the current session is not attached. The template may be deleted
+     * at any time, the registry only observes it.
+     */
+    void watch(Wt::WTemplate* widget);
+
+    /**
+     * @brief How long the bundles have to be quiet before a batch is sent
+     */
+    void setDebounce(std::chrono::milliseconds debounce);
+
+    /**
+     * @brief Number of batches sent so far
+     */
+    std::uint64_t generation() const { return generation_.load(std::memory_order_acquire); }
+
+private:
+    struct Message {
+        std::uint32_t hash = 0;                     ///< of the whole message element
+        std::set<std::string> includes;             ///< ids it includes through ${tr:...} and ${block:...}
+    };
+    using Messages = std::map<std::string, Message>;  ///< by message id
+
+    struct Session {
+        std::multimap<std::string, Wt::Core::observing_ptr<Wt::WTemplate>> templates;  ///< by message id
+        std::set<std::string> changed;              ///< ids of the batches not applied yet
+        bool class_lists = false;                   ///< one of the batches changed the theme's class lists
+    };
+
+    TemplateHotSwap();
+
+    void filesChanged(std::shared_ptr<const FileIndex::Snapshot> snapshot);
+    void run();
+    std::set<std::string> reparse(const std::set<std::string>& paths);
+    std::set<std::string> includers(std::set<std::string> ids) const;
+    void broadcast(const std::set<std::string>& ids, bool classLists);
+    void update(const std::string& sessionId);
+    static bool parse(const std::string& path, Messages& messages);
+
+    std::string directory_;
+    std::string root_;
+    int subscription_ = -1;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::set<std::string> pending_;                 ///< relative paths changed since the last batch
+    std::chrono::steady_clock::time_point first_change_;
+    std::chrono::steady_clock::time_point last_change_;
+    std::chrono::milliseconds debounce_{200};
+    std::map<std::string, FileIndex::File> files_;  ///< bundle files as last seen by the listener
+    bool started_ = false;
+    bool stop_ = false;
+
+    // Owned by the worker thread once started
+    std::map<std::string, Messages> bundles_;       ///< relative path to its parsed messages
+
+    std::mutex sessions_mutex_;
+    std::map<std::string, Session> sessions_;      ///< attached sessions by session id
+
+    std::atomic<std::uint64_t> generation_{0};
+    std::thread worker_;
+};
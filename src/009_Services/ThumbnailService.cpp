@@ -0,0 +1,273 @@
+#include "009_Services/ThumbnailService.h"
+
+#include <Wt/WConfig.h>
+#include <Wt/WLogger.h>
+
+#ifdef WT_HAS_WRASTERIMAGE
+#include <Wt/WPainter.h>
+#include <Wt/WRasterImage.h>
+#include <Wt/WRectF.h>
+#endif
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+
+// Enough for a grid, a preview and a large preview
+const int VARIANT_WIDTHS[] = {64, 128, 256, 512};
+
+// Queued beyond this, requests are turned away until the workers catch up
+const std::size_t MAX_QUEUED = 256;
+
+const std::size_t READ_CHUNK = 64 * 1024;
+
+std::string jobKey(const std::string& source, int width)
+{
+    return source + '#' + std::to_string(width);
+}
+
+bool statFile(const std::string& path, struct stat& st)
+{
+    return ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
+}
+
+std::int64_t mtimeNanoseconds(const struct stat& st)
+{
+    return static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+}
+
+ThumbnailService& ThumbnailService::instance()
+{
+    static ThumbnailService service;
+    return service;
+}
+
+ThumbnailService::ThumbnailService()
+{
+}
+
+ThumbnailService::~ThumbnailService()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThumbnailService::start(const std::string& cacheDirectory, unsigned workers)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (started_) {
+        return;
+    }
+    started_ = true;
+    cache_directory_ = cacheDirectory;
+
+    std::error_code error;
+    std::filesystem::create_directories(cache_directory_, error);
+    if (error) {
+        Wt::log("error") << "ThumbnailService: cannot create " << cache_directory_ << ": " << error.message();
+    }
+
+    for (unsigned i = 0; i < std::max(1u, workers); ++i) {
+        workers_.emplace_back(&ThumbnailService::run, this);
+    }
+}
+
+bool ThumbnailService::available()
+{
+#ifdef WT_HAS_WRASTERIMAGE
+    return true;
+#else
+    return false;
+#endif
+}
+
+int ThumbnailService::variantWidth(int requested)
+{
+    for (int width : VARIANT_WIDTHS) {
+        if (requested <= width) {
+            return width;
+        }
+    }
+    return VARIANT_WIDTHS[sizeof(VARIANT_WIDTHS) / sizeof(VARIANT_WIDTHS[0]) - 1];
+}
+
+std::string ThumbnailService::variantPath(const std::string& hash, int width) const
+{
+    return cache_directory_ + "/" + hash + "-" + std::to_string(width) + ".png";
+}
+
+bool ThumbnailService::cached(const std::string& source, int width, std::string& path)
+{
+    struct stat st;
+    if (!statFile(source, st)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = fingerprints_.find(source);
+    if (it == fingerprints_.end() || it->second.size != static_cast<std::uintmax_t>(st.st_size)
+        || it->second.mtime != mtimeNanoseconds(st)) {
+        return false;
+    }
+    path = variantPath(it->second.hash, width);
+    struct stat variant;
+    return statFile(path, variant);
+}
+
+bool ThumbnailService::request(const std::string& source, int width, Completion done)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::string key = jobKey(source, width);
+        auto it = waiting_.find(key);
+        if (it != waiting_.end()) {
+            it->second.push_back(std::move(done));
+            return true;
+        }
+        if (!started_ || queue_.size() >= MAX_QUEUED) {
+            return false;
+        }
+        waiting_[key].push_back(std::move(done));
+        queue_.push_back(Job{source, width});
+    }
+    wake_.notify_one();
+    return true;
+}
+
+void ThumbnailService::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (stop_) {
+            return;
+        }
+
+        const Job job = queue_.front();
+        queue_.pop_front();
+        lock.unlock();
+
+        const Result result = generate(job);
+
+        lock.lock();
+        auto it = waiting_.find(jobKey(job.source, job.width));
+        std::vector<Completion> completions = std::move(it->second);
+        waiting_.erase(it);
+        lock.unlock();
+
+        for (const Completion& done : completions) {
+            done(result);
+        }
+        lock.lock();
+    }
+}
+
+// Content hash of a source, read again only when its size or mtime changed
+bool ThumbnailService::fingerprint(const std::string& source, std::string& hash, std::string& error)
+{
+    struct stat st;
+    if (!statFile(source, st)) {
+        error = "no such file";
+        return false;
+    }
+    const std::uintmax_t size = static_cast<std::uintmax_t>(st.st_size);
+    const std::int64_t mtime = mtimeNanoseconds(st);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = fingerprints_.find(source);
+        if (it != fingerprints_.end() && it->second.size == size && it->second.mtime == mtime) {
+            hash = it->second.hash;
+            return true;
+        }
+    }
+
+    std::ifstream file(source, std::ios::binary);
+    if (!file.is_open()) {
+        error = "cannot read the file";
+        return false;
+    }
+    std::uint64_t value = 14695981039346656037ull;
+    std::vector<char> buffer(READ_CHUNK);
+    while (file.read(buffer.data(), buffer.size()) || file.gcount() > 0) {
+        for (std::streamsize i = 0; i < file.gcount(); ++i) {
+            value ^= static_cast<unsigned char>(buffer[i]);
+            value *= 1099511628211ull;
+        }
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(value));
+    hash = hex;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    fingerprints_[source] = Fingerprint{size, mtime, hash};
+    return true;
+}
+
+ThumbnailService::Result ThumbnailService::generate(const Job& job)
+{
+    Result result;
+    std::string hash;
+    if (!fingerprint(job.source, hash, result.error)) {
+        return result;
+    }
+
+    result.path = variantPath(hash, job.width);
+    struct stat st;
+    if (statFile(result.path, st)) {
+        result.ok = true;
+        return result;
+    }
+
+#ifdef WT_HAS_WRASTERIMAGE
+    try {
+        // Reads the dimensions from the file's header, the pixels are only decoded by drawImage()
+        const Wt::WPainter::Image image(job.source, job.source);
+        const double scale = std::min(1.0, static_cast<double>(job.width) / image.width());
+        const int width = std::max(1, static_cast<int>(image.width() * scale + 0.5));
+        const int height = std::max(1, static_cast<int>(image.height() * scale + 0.5));
+
+        Wt::WRasterImage raster("png", width, height);
+        {
+            Wt::WPainter painter(&raster);
+            painter.drawImage(Wt::WRectF(0, 0, width, height), image);
+        }
+
+        // Written next to the cache entry and renamed, a reader never sees half a
+        // file. Two sources with the same content may race for the same entry.
+        const std::string partial = result.path + ".partial-"
+            + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            std::ofstream out(partial, std::ios::binary);
+            raster.write(out);
+            if (!out) {
+                result.error = "cannot write " + partial;
+                return result;
+            }
+        }
+        if (std::rename(partial.c_str(), result.path.c_str()) != 0) {
+            result.error = "cannot rename " + partial;
+            return result;
+        }
+        result.ok = true;
+    } catch (const std::exception& e) {
+        result.error = e.what();
+        Wt::log("error") << "ThumbnailService: cannot resize " << job.source << ": " << e.what();
+    }
+#else
+    result.error = "resizing needs Wt with WRasterImage";
+#endif
+    return result;
+}
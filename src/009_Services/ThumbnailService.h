@@ -0,0 +1,110 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Process-wide pool generating resized variants of images on disk
+ *
+ * A variant is generated the first time it is asked for and kept in the cache
+ * directory under the hash of the source's content and its width, so an edited
+ * image gets new variants and an unchanged one is never resized twice. The
+ * content hash of a source is remembered together with its size and mtime,
+ * only a changed file is read again.
+ *
+ * Generation runs on a fixed number of worker threads, never on a request
+ * thread, and the queue is bounded, so a burst of thumbnails can neither take
+ * over the server's threads nor grow without limit. Requests for a variant
+ * already being generated join that job.
+ *
+ * Resizing needs Wt built with WRasterImage (WT_HAS_WRASTERIMAGE), without it
+ * available() is false and callers serve the originals.
+ *
+ * Completions run on a worker thread.
+ */
+class ThumbnailService {
+public:
+    struct Result {
+        bool ok = false;
+        std::string path;   ///< of the variant on disk
+        std::string error;
+    };
+
+    using Completion = std::function<void(const Result& result)>;
+
+    static ThumbnailService& instance();
+
+    ~ThumbnailService();
+
+    ThumbnailService(const ThumbnailService&) = delete;
+    ThumbnailService& operator=(const ThumbnailService&) = delete;
+
+    /**
+     * @brief Sets where variants are kept and starts the workers, only the first call has an effect
+     * @param cacheDirectory Created if missing
+     * @param workers Threads resizing at the same time
+     */
+    void start(const std::string& cacheDirectory, unsigned workers);
+
+    /**
+     * @brief Whether this build can resize images at all
+     */
+    static bool available();
+
+    /**
+     * @brief Width of the variant served for a requested width
+     *
+     * Widths are rounded up to a few fixed steps so the cache holds a bounded
+     * number of variants per image.
+     */
+    static int variantWidth(int requested);
+
+    /**
+     * @brief Looks up a variant without generating it, never reads the source's content
+     * @return true and the variant's path in path if it is on disk and the source unchanged
+     */
+    bool cached(const std::string& source, int width, std::string& path);
+
+    /**
+     * @brief Queues the generation of a variant
+     * @return false if the queue is full, done is not called then
+     */
+    bool request(const std::string& source, int width, Completion done);
+
+private:
+    struct Fingerprint {
+        std::uintmax_t size = 0;
+        std::int64_t mtime = 0;
+        std::string hash;
+    };
+
+    struct Job {
+        std::string source;
+        int width = 0;
+    };
+
+    ThumbnailService();
+
+    void run();
+    Result generate(const Job& job);
+    bool fingerprint(const std::string& source, std::string& hash, std::string& error);
+    std::string variantPath(const std::string& hash, int width) const;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Job> queue_;
+    std::map<std::string, std::vector<Completion>> waiting_;   ///< job key to its completions
+    std::unordered_map<std::string, Fingerprint> fingerprints_;
+    std::string cache_directory_;
+    bool started_ = false;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
@@ -0,0 +1,314 @@
+#include "009_Services/XmlValidator.h"
+
+#include <tinyxml2.h>
+
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// Enough to point at the problems, a broken file should not flood the editor
+const std::size_t MAX_DIAGNOSTICS = 200;
+
+/*
+ * Walks the raw text keeping track of the line and the UTF-16 column, which is
+ * what Monaco positions are in.
+ */
+class Cursor {
+public:
+    explicit Cursor(std::string_view text) : text_(text) {}
+
+    bool done() const { return pos_ >= text_.size(); }
+    bool at(const char* token) const { return text_.compare(pos_, std::strlen(token), token) == 0; }
+    std::size_t pos() const { return pos_; }
+    int line() const { return line_; }
+    int column() const { return column_; }
+
+    void advance(std::size_t bytes = 1)
+    {
+        for (const std::size_t end = std::min(pos_ + bytes, text_.size()); pos_ < end; ++pos_) {
+            const unsigned char c = static_cast<unsigned char>(text_[pos_]);
+            if (c == '\n') {
+                ++line_;
+                column_ = 1;
+            } else if (c < 0x80 || c >= 0xC0) {
+                column_ += c >= 0xF0 ? 2 : 1;
+            }
+        }
+    }
+
+    // Moves past the next occurrence of token, or to the end
+    void skipPast(const char* token)
+    {
+        const std::size_t found = text_.find(token, pos_);
+        advance(found == std::string_view::npos ? text_.size() - pos_ : found - pos_ + std::strlen(token));
+    }
+
+private:
+    std::string_view text_;
+    std::size_t pos_ = 0;
+    int line_ = 1;
+    int column_ = 1;
+};
+
+struct Placeholder {
+    std::string text;   ///< between ${ and }
+    int line;
+    int column;
+    int end_column;
+};
+
+XmlValidator::Diagnostic at(const Placeholder& placeholder, bool error, std::string message)
+{
+    XmlValidator::Diagnostic diagnostic;
+    diagnostic.line = placeholder.line;
+    diagnostic.column = placeholder.column;
+    diagnostic.end_line = placeholder.line;
+    diagnostic.end_column = placeholder.end_column;
+    diagnostic.error = error;
+    diagnostic.message = std::move(message);
+    return diagnostic;
+}
+
+XmlValidator::Diagnostic onLine(int line, bool error, std::string message)
+{
+    XmlValidator::Diagnostic diagnostic;
+    diagnostic.line = line;
+    diagnostic.end_line = line;
+    diagnostic.error = error;
+    diagnostic.message = std::move(message);
+    return diagnostic;
+}
+
+// Checks the placeholders of one <message>, the way WTemplate resolves them
+void checkTemplate(const std::vector<Placeholder>& placeholders, std::vector<XmlValidator::Diagnostic>& diagnostics)
+{
+    std::vector<const Placeholder*> conditions;
+    std::unordered_set<std::string> bound;
+    std::vector<std::pair<const Placeholder*, std::string>> ids;
+
+    for (const Placeholder& placeholder : placeholders) {
+        const std::string& text = placeholder.text;
+        if (text.rfind("<if:", 0) == 0) {
+            conditions.push_back(&placeholder);
+        } else if (text.rfind("</if:", 0) == 0) {
+            const std::string name = text.substr(5);
+            if (conditions.empty()) {
+                diagnostics.push_back(at(placeholder, true, "${" + text + "} closes a condition that is not open"));
+            } else if (conditions.back()->text.substr(4) != name) {
+                diagnostics.push_back(at(placeholder, true, "${" + text + "} closes ${" + conditions.back()->text + "}"));
+                conditions.pop_back();
+            } else {
+                conditions.pop_back();
+            }
+        } else {
+            const std::string name = text.substr(0, text.find_first_of(" \t\r\n"));
+            const std::size_t colon = name.find(':');
+            if (colon == std::string::npos) {
+                bound.insert(name);
+            } else if (name.compare(0, colon, "id") == 0) {
+                ids.emplace_back(&placeholder, name.substr(colon + 1));
+            }
+        }
+    }
+
+    for (const Placeholder* condition : conditions) {
+        diagnostics.push_back(at(*condition, true, "${" + condition->text + "} is never closed"));
+    }
+    for (const auto& id : ids) {
+        if (!bound.count(id.second)) {
+            diagnostics.push_back(at(*id.first, false, "${" + id.first->text + "} refers to ${" + id.second
+                + "}, which this template does not bind"));
+        }
+    }
+}
+
+void checkPlaceholders(std::string_view text, const std::atomic<bool>& cancelled,
+                       std::vector<XmlValidator::Diagnostic>& diagnostics)
+{
+    Cursor cursor(text);
+    bool inMessage = false;
+    std::vector<Placeholder> placeholders;
+
+    while (!cursor.done() && !cancelled.load(std::memory_order_relaxed)) {
+        if (cursor.at("<!--")) {
+            cursor.skipPast("-->");
+        } else if (cursor.at("<message") && (cursor.at("<message ") || cursor.at("<message>"))) {
+            inMessage = true;
+            placeholders.clear();
+            cursor.advance(8);
+        } else if (cursor.at("</message>")) {
+            if (inMessage) {
+                checkTemplate(placeholders, diagnostics);
+            }
+            inMessage = false;
+            cursor.advance(10);
+        } else if (inMessage && cursor.at("$$")) {
+            cursor.advance(2);
+        } else if (inMessage && cursor.at("${")) {
+            const std::size_t start = cursor.pos() + 2;
+            const std::size_t lineEnd = std::min(text.find('\n', start), text.size());
+            const std::size_t end = text.substr(0, lineEnd).find('}', start);
+
+            Placeholder placeholder{"", cursor.line(), cursor.column(), 0};
+            if (end == std::string_view::npos) {
+                cursor.advance(lineEnd - cursor.pos());
+                placeholder.end_column = cursor.column();
+                diagnostics.push_back(at(placeholder, true, "Placeholder is not terminated with }"));
+                continue;
+            }
+            placeholder.text = std::string(text.substr(start, end - start));
+            cursor.advance(end + 1 - cursor.pos());
+            placeholder.end_column = cursor.column();
+            placeholders.push_back(std::move(placeholder));
+        } else {
+            cursor.advance();
+        }
+    }
+}
+
+}
+
+XmlValidator& XmlValidator::instance()
+{
+    static XmlValidator validator;
+    return validator;
+}
+
+XmlValidator::XmlValidator()
+    : worker_(&XmlValidator::run, this)
+{
+}
+
+XmlValidator::~XmlValidator()
+{
+    // Pending checks are dropped, nobody is left to show their result
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+        jobs_.clear();
+    }
+    cancelled_ = true;
+    wake_.notify_one();
+    worker_.join();
+}
+
+void XmlValidator::validate(const std::string& key, std::vector<std::string_view> parts,
+                            std::shared_ptr<const void> owner, Completion done)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (key == running_) {
+            cancelled_ = true;
+        }
+        Job& job = jobs_[key];
+        job.parts = std::move(parts);
+        job.owner = std::move(owner);
+        job.done = std::move(done);
+        job.due = Clock::now() + debounce_;
+    }
+    wake_.notify_one();
+}
+
+void XmlValidator::cancel(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.erase(key);
+    if (key == running_) {
+        cancelled_ = true;
+    }
+}
+
+void XmlValidator::setDebounce(std::chrono::milliseconds debounce)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    debounce_ = debounce;
+}
+
+void XmlValidator::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        if (jobs_.empty()) {
+            wake_.wait(lock);
+            continue;
+        }
+
+        auto next = std::min_element(jobs_.begin(), jobs_.end(), [](const auto& a, const auto& b) {
+            return a.second.due < b.second.due;
+        });
+        if (next->second.due > Clock::now()) {
+            wake_.wait_until(lock, next->second.due);
+            continue;
+        }
+
+        running_ = next->first;
+        Job job = std::move(next->second);
+        jobs_.erase(next);
+        cancelled_ = false;
+        lock.unlock();
+
+        std::string text;
+        for (std::string_view part : job.parts) {
+            text.append(part);
+        }
+        std::vector<Diagnostic> diagnostics = check(text, cancelled_);
+
+        lock.lock();
+        running_.clear();
+        if (!cancelled_) {
+            lock.unlock();
+            job.done(std::move(diagnostics));
+            lock.lock();
+        }
+    }
+}
+
+std::vector<XmlValidator::Diagnostic> XmlValidator::check(std::string_view text)
+{
+    const std::atomic<bool> cancelled{false};
+    return check(text, cancelled);
+}
+
+std::vector<XmlValidator::Diagnostic> XmlValidator::check(std::string_view text, const std::atomic<bool>& cancelled)
+{
+    std::vector<Diagnostic> diagnostics;
+
+    tinyxml2::XMLDocument doc;
+    if (doc.Parse(text.data(), text.size()) != tinyxml2::XML_SUCCESS) {
+        diagnostics.push_back(onLine(std::max(doc.ErrorLineNum(), 1), true, doc.ErrorStr()));
+        return diagnostics;
+    }
+
+    // Only message bundles have ids and templates
+    const tinyxml2::XMLElement* root = doc.RootElement();
+    if (!root || std::strcmp(root->Name(), "messages") != 0) {
+        return diagnostics;
+    }
+
+    std::unordered_map<std::string, int> lines;
+    for (auto message = root->FirstChildElement("message"); message; message = message->NextSiblingElement("message")) {
+        const char* id = message->Attribute("id");
+        if (!id) {
+            diagnostics.push_back(onLine(message->GetLineNum(), true, "Message has no id"));
+            continue;
+        }
+        auto inserted = lines.emplace(id, message->GetLineNum());
+        if (!inserted.second) {
+            diagnostics.push_back(onLine(message->GetLineNum(), true, std::string("Message id '") + id
+                + "' is already defined on line " + std::to_string(inserted.first->second)));
+        }
+    }
+
+    checkPlaceholders(text, cancelled, diagnostics);
+
+    std::stable_sort(diagnostics.begin(), diagnostics.end(), [](const Diagnostic& a, const Diagnostic& b) {
+        return a.line != b.line ? a.line < b.line : a.column < b.column;
+    });
+    if (diagnostics.size() > MAX_DIAGNOSTICS) {
+        diagnostics.resize(MAX_DIAGNOSTICS);
+    }
+    return diagnostics;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Process-wide background validator for the XML message bundles
+ *
+ * Checks run on one worker thread, never on a session's thread. A document is
+ * parsed with tinyxml2 and, if its root is <messages>, checked for missing and
+ * duplicate message ids and for template placeholders that do not add up:
+ * unterminated ${...}, unbalanced ${<if:...>} conditions and ${id:name} without
+ * a ${name} binding in the same template.
+ *
+ * Requests are debounced per key, a request for a key that is still waiting
+ * replaces it and one for a key being checked cancels that check, so a burst of
+ * edits costs one validation of the final text.
+ *
+ * Completions run on the worker thread, use Wt::WServer::post() to get back
+ * into a session.
+ */
+class XmlValidator {
+public:
+    /**
+     * @brief One problem, positions are 1-based lines and UTF-16 columns like Monaco's
+     */
+    struct Diagnostic {
+        int line = 1;
+        int column = 1;
+        int end_line = 1;
+        int end_column = 0;     ///< 0 marks the whole line
+        bool error = true;      ///< false for warnings
+        std::string message;
+    };
+
+    /**
+     * @brief Called with the result of a check that was not cancelled
+     */
+    using Completion = std::function<void(std::vector<Diagnostic> diagnostics)>;
+
+    static XmlValidator& instance();
+
+    ~XmlValidator();
+
+    XmlValidator(const XmlValidator&) = delete;
+    XmlValidator& operator=(const XmlValidator&) = delete;
+
+    /**
+     * @brief Schedules a check of text held elsewhere, without copying it
+     * @param key Identifies the document, a newer request for it supersedes this one
+     * @param parts Text, one part after the other
+     * @param owner Keeps the memory of parts alive until the check is done
+     * @param done Completion
+     */
+    void validate(const std::string& key, std::vector<std::string_view> parts, std::shared_ptr<const void> owner,
+                  Completion done);
+
+    /**
+     * @brief Drops the pending or running check of a document
+     */
+    void cancel(const std::string& key);
+
+    /**
+     * @brief Sets how long a document has to stay unchanged before it is checked, 400 ms by default
+     */
+    void setDebounce(std::chrono::milliseconds debounce);
+
+    /**
+     * @brief Checks a text on the calling thread
+     */
+    static std::vector<Diagnostic> check(std::string_view text);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        std::vector<std::string_view> parts;
+        std::shared_ptr<const void> owner;
+        Completion done;
+        Clock::time_point due;
+    };
+
+    XmlValidator();
+
+    void run();
+    static std::vector<Diagnostic> check(std::string_view text, const std::atomic<bool>& cancelled);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::unordered_map<std::string, Job> jobs_;     ///< pending job per key
+    std::string running_;                           ///< key of the check in progress
+    std::atomic<bool> cancelled_{false};            ///< set to abandon the check in progress
+    std::chrono::milliseconds debounce_{400};
+    bool stopping_ = false;
+    std::thread worker_;
+};
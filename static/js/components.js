@@ -0,0 +1,677 @@
+/*
+ * Client side of the 005_Components widgets, loaded once per session with
+ * WApplication::require(). Widgets only make small calls into it keyed by their
+ * id, and call destroy() from their destructor so nothing outlives them.
+ */
+(function () {
+    'use strict';
+
+    if (window.StylusComponents) {
+        return;
+    }
+
+    /*
+     * DragBar: resizes a target element horizontally. The bar captures the
+     * pointer for the whole drag, so no document listeners are needed, and moves
+     * only record the position: the width is written at most once per animation
+     * frame. The server hears about the final width once, when the drag ends.
+     */
+    var dragBars = {};
+
+    var dragBar = {
+        init: function (id, targetId, minWidth, maxWidth) {
+            var bar = document.getElementById(id);
+            var target = document.getElementById(targetId);
+            if (!bar || !target) {
+                return;
+            }
+            dragBar.destroy(id);
+
+            var state = { bar: bar, frame: 0, pointerId: null };
+
+            function clamp(width) {
+                return Math.min(Math.max(width, minWidth), maxWidth);
+            }
+
+            function render() {
+                state.frame = 0;
+                target.style.width = clamp(state.startWidth + state.x - state.startX) + 'px';
+            }
+
+            state.onDown = function (e) {
+                if (state.pointerId !== null || e.button !== 0) {
+                    return;
+                }
+                state.pointerId = e.pointerId;
+                state.startX = state.x = e.clientX;
+                state.startWidth = target.offsetWidth;
+                bar.setPointerCapture(e.pointerId);
+                document.body.style.cursor = 'col-resize';
+                document.body.style.userSelect = 'none';
+                e.preventDefault();
+            };
+            state.onMove = function (e) {
+                if (e.pointerId !== state.pointerId) {
+                    return;
+                }
+                state.x = e.clientX;
+                if (!state.frame) {
+                    state.frame = requestAnimationFrame(render);
+                }
+            };
+            state.onEnd = function (e) {
+                if (e.pointerId !== state.pointerId) {
+                    return;
+                }
+                state.pointerId = null;
+                if (state.frame) {
+                    cancelAnimationFrame(state.frame);
+                    render();
+                }
+                if (bar.hasPointerCapture(e.pointerId)) {
+                    bar.releasePointerCapture(e.pointerId);
+                }
+                document.body.style.cursor = '';
+                document.body.style.userSelect = '';
+                var width = target.offsetWidth;
+                if (width !== state.startWidth) {
+                    Wt.emit(id, 'widthChanged', width);
+                }
+            };
+
+            bar.style.touchAction = 'none';
+            bar.addEventListener('pointerdown', state.onDown);
+            bar.addEventListener('pointermove', state.onMove);
+            bar.addEventListener('pointerup', state.onEnd);
+            bar.addEventListener('pointercancel', state.onEnd);
+            bar.addEventListener('lostpointercapture', state.onEnd);
+            dragBars[id] = state;
+        },
+
+        destroy: function (id) {
+            var state = dragBars[id];
+            if (!state) {
+                return;
+            }
+            if (state.frame) {
+                cancelAnimationFrame(state.frame);
+            }
+            if (state.pointerId !== null) {
+                document.body.style.cursor = '';
+                document.body.style.userSelect = '';
+            }
+            state.bar.removeEventListener('pointerdown', state.onDown);
+            state.bar.removeEventListener('pointermove', state.onMove);
+            state.bar.removeEventListener('pointerup', state.onEnd);
+            state.bar.removeEventListener('pointercancel', state.onEnd);
+            state.bar.removeEventListener('lostpointercapture', state.onEnd);
+            delete dragBars[id];
+        }
+    };
+
+    /*
+     * MonacoEditor: creates the editor and implements the sync protocol of
+     * MonacoEditor.cpp. Every call waits for the editor through its ready
+     * promise instead of polling.
+     *
+     * Each open file is a tab with its own Monaco model, identified by the
+     * generation the server assigned when it loaded the file. Switching tabs
+     * swaps the model locally and only tells the server afterwards.
+     */
+    var editors = {};
+    var monacoLoaded = null;
+    var darkTheme = null;   // last setDarkTheme(), overrides the theme the widget was created with
+
+    var TAB_BAR_CLASSES = 'flex items-center gap-2 px-2 border-b border-gray-200 text-xs whitespace-nowrap overflow-hidden shrink-0';
+    var TAB_CLASSES = 'flex items-center gap-2 px-2 cursor-pointer';
+    var TAB_ACTIVE_CLASSES = 'font-semibold';
+    var TAB_INACTIVE_CLASSES = 'opacity-60';
+    var TAB_CLOSE_CLASSES = 'cursor-pointer opacity-60';
+
+    var tailwindIndex = null;       // promise of the TailwindIndexResource JSON, fetched once per page
+    var completionsRegistered = false;
+    var MAX_COMPLETIONS = 200;
+
+    var LANGUAGES = { xml: 'xml', css: 'css', js: 'javascript', json: 'json', html: 'html', md: 'markdown' };
+
+    function loadMonaco(vsUrl) {
+        if (!monacoLoaded) {
+            require.config({ paths: { 'vs': vsUrl } });
+            // Same origin, so the workers can be started from the vendored files directly
+            window.MonacoEnvironment = {
+                getWorkerUrl: function () { return vsUrl + '/base/worker/workerMain.js'; }
+            };
+            monacoLoaded = new Promise(function (resolve) {
+                require(['vs/editor/editor.main'], resolve);
+            });
+        }
+        return monacoLoaded;
+    }
+
+    // The record of an editor, created by the first call for its id
+    function instance(id) {
+        var state = editors[id];
+        if (!state) {
+            state = editors[id] = {
+                editor: null,
+                tabBar: null,
+                language: 'plaintext',
+                documents: {},      // by generation
+                active: null,
+                readOnly: false,
+                idleMs: 300,
+                maxLatencyMs: 1000,
+                checksumDelayMs: 2000
+            };
+            state.ready = new Promise(function (resolve) {
+                state.resolve = resolve;
+            });
+        }
+        return state;
+    }
+
+    function withEditor(id, f) {
+        var state = instance(id);
+        state.ready.then(function () {
+            if (editors[id] === state) {
+                f(state.editor, state);
+            }
+        });
+    }
+
+    function clearTimers(doc) {
+        for (var name in doc.timers) {
+            clearTimeout(doc.timers[name]);
+        }
+        doc.timers = {};
+    }
+
+    // FNV-1a over the UTF-8 bytes, same as PieceTable::checksum()
+    function checksum(text) {
+        var bytes = new TextEncoder().encode(text);
+        var hash = 0x811c9dc5;
+        for (var i = 0; i < bytes.length; i++) {
+            hash = Math.imul(hash ^ bytes[i], 0x01000193) >>> 0;
+        }
+        return hash.toString(16);
+    }
+
+    // Sends the coalesced changes of a document as one delta
+    function flush(id, doc) {
+        clearTimeout(doc.timers.idle);
+        clearTimeout(doc.timers.latency);
+        doc.timers.latency = null;
+        if (doc.pending.length === 0) {
+            return;
+        }
+        Wt.emit(id, 'editorDelta', doc.generation, ++doc.seq, JSON.stringify(doc.pending));
+        doc.pending = [];
+    }
+
+    function onContentChanged(id, state, doc, event) {
+        // setValue() and the chunks appended while loading, the server loaded the same file
+        if (event.isFlush || doc.loading) {
+            return;
+        }
+        // Changes of one event share the offsets of the text before it, applying
+        // them back to front keeps every offset valid. Events are queued in order,
+        // so the server can apply a coalesced batch front to back.
+        var changes = event.changes.slice().sort(function (a, b) { return b.rangeOffset - a.rangeOffset; });
+        for (var i = 0; i < changes.length; i++) {
+            doc.pending.push([changes[i].rangeOffset, changes[i].rangeLength, changes[i].text]);
+        }
+
+        // Changes go out once the typing pauses for idleMs, and at the latest
+        // maxLatencyMs after the first one, so a burst of typing is one delta.
+        // See tests/js/monaco-coalescing.test.js.
+        if (!doc.timers.latency) {
+            doc.timers.latency = setTimeout(function () { flush(id, doc); }, state.maxLatencyMs);
+        }
+        clearTimeout(doc.timers.idle);
+        doc.timers.idle = setTimeout(function () { flush(id, doc); }, state.idleMs);
+
+        clearTimeout(doc.timers.checksum);
+        doc.timers.checksum = setTimeout(function () {
+            flush(id, doc);
+            Wt.emit(id, 'editorChecksum', doc.generation, doc.seq, checksum(doc.model.getValue()));
+        }, state.checksumDelayMs);
+    }
+
+    function basename(path) {
+        return path.substring(path.lastIndexOf('/') + 1);
+    }
+
+    function languageOf(state, path) {
+        var dot = path.lastIndexOf('.');
+        return (dot >= 0 && LANGUAGES[path.substring(dot + 1)]) || state.language;
+    }
+
+    function renderTabs(id, state) {
+        var bar = state.tabBar;
+        bar.textContent = '';
+        var generations = Object.keys(state.documents);
+        bar.style.display = generations.length > 0 ? '' : 'none';
+
+        generations.forEach(function (generation) {
+            var doc = state.documents[generation];
+            var tab = document.createElement('div');
+            tab.className = TAB_CLASSES + ' ' + (doc === state.active ? TAB_ACTIVE_CLASSES : TAB_INACTIVE_CLASSES);
+            tab.title = doc.path;
+            tab.textContent = basename(doc.path);
+            tab.addEventListener('click', function () {
+                activate(id, state, doc);
+            });
+
+            var close = document.createElement('span');
+            close.className = TAB_CLOSE_CLASSES;
+            close.textContent = '×';
+            close.addEventListener('click', function (e) {
+                e.stopPropagation();
+                closeDocument(id, state, doc);
+                Wt.emit(id, 'editorClosed', doc.generation);
+            });
+            tab.appendChild(close);
+            bar.appendChild(tab);
+        });
+    }
+
+    // Shows a document, keeping the cursor and scroll position of the one it replaces
+    function activate(id, state, doc) {
+        if (state.active === doc) {
+            return;
+        }
+        if (state.active) {
+            flush(id, state.active);
+            state.active.viewState = state.editor.saveViewState();
+        }
+        state.active = doc;
+        state.editor.setModel(doc ? doc.model : null);
+        if (doc) {
+            if (doc.viewState) {
+                state.editor.restoreViewState(doc.viewState);
+            }
+            state.editor.updateOptions({
+                readOnly: state.readOnly || doc.loading,
+                wordWrap: doc.large ? 'off' : 'on',
+                folding: !doc.large
+            });
+            state.editor.focus();
+            Wt.emit(id, 'editorActivated', doc.generation);
+        }
+        renderTabs(id, state);
+    }
+
+    // Forgets a document the server no longer knows, without showing another one
+    function dropDocument(state, doc) {
+        clearTimers(doc);
+        doc.closed = true;
+        delete state.documents[doc.generation];
+        if (state.active === doc) {
+            state.active = null;
+            state.editor.setModel(null);
+        }
+        doc.model.dispose();
+    }
+
+    // Closes a tab and shows the most recently loaded remaining one, as MonacoEditor::removeDocument() does
+    function closeDocument(id, state, doc) {
+        flush(id, doc);
+        var wasActive = state.active === doc;
+        dropDocument(state, doc);
+        var remaining = Object.keys(state.documents);
+        if (wasActive && remaining.length > 0) {
+            activate(id, state, state.documents[remaining[remaining.length - 1]]);
+        } else {
+            renderTabs(id, state);
+        }
+    }
+
+    // Large files are shown as the chunks of the response arrive, read-only until the last one
+    function streamText(id, state, doc, response) {
+        var model = doc.model;
+        var reader = response.body.getReader();
+        var decoder = new TextDecoder();
+
+        function append(text) {
+            var line = model.getLineCount();
+            var column = model.getLineMaxColumn(line);
+            model.applyEdits([{ range: new monaco.Range(line, column, line, column), text: text }]);
+        }
+
+        function pump() {
+            return reader.read().then(function (chunk) {
+                if (doc.closed || editors[id] !== state) {
+                    reader.cancel();
+                    return;
+                }
+                var text = decoder.decode(chunk.value || new Uint8Array(), { stream: !chunk.done });
+                if (text) {
+                    append(text);
+                }
+                if (chunk.done) {
+                    doc.loading = false;
+                    if (state.active === doc) {
+                        state.editor.updateOptions({ readOnly: state.readOnly });
+                    }
+                    return;
+                }
+                return pump();
+            });
+        }
+        return pump();
+    }
+
+    // Index of the first class not sorting before prefix, the index is sorted by code unit like the server's std::map
+    function lowerBound(classes, prefix) {
+        var low = 0;
+        var high = classes.length;
+        while (low < high) {
+            var mid = (low + high) >>> 1;
+            if (classes[mid] < prefix) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        return low;
+    }
+
+    /*
+     * Completes Tailwind classes inside class="..." and in messages holding a bare
+     * class list, like the ones of General_components.xml. Variants typed before
+     * the last ':' (hover:, dark:md:, ...) are kept and the rest is looked up.
+     */
+    function registerCompletions(url) {
+        if (completionsRegistered) {
+            return;
+        }
+        completionsRegistered = true;
+        tailwindIndex = fetch(url).then(function (response) { return response.json(); });
+
+        ['xml', 'html'].forEach(function (language) {
+            monaco.languages.registerCompletionItemProvider(language, {
+                triggerCharacters: [' ', '"', ':', '-'],
+                provideCompletionItems: function (model, position) {
+                    var before = model.getValueInRange({
+                        startLineNumber: position.lineNumber, startColumn: 1,
+                        endLineNumber: position.lineNumber, endColumn: position.column
+                    });
+                    if (!/class\s*=\s*"[^"]*$/.test(before) && !/<message[^>]*>[^<]*$/.test(before)) {
+                        return { suggestions: [] };
+                    }
+                    var token = /[^\s"'<>]*$/.exec(before)[0];
+                    var variants = token.substring(0, token.lastIndexOf(':') + 1);
+                    var prefix = token.substring(variants.length);
+                    var range = {
+                        startLineNumber: position.lineNumber, startColumn: position.column - prefix.length,
+                        endLineNumber: position.lineNumber, endColumn: position.column
+                    };
+
+                    return tailwindIndex.then(function (index) {
+                        var suggestions = [];
+                        for (var i = lowerBound(index.classes, prefix);
+                             i < index.classes.length && suggestions.length < MAX_COMPLETIONS; i++) {
+                            var cls = index.classes[i];
+                            if (cls.substring(0, prefix.length) !== prefix) {
+                                break;
+                            }
+                            suggestions.push({
+                                label: variants + cls,
+                                filterText: cls,
+                                insertText: cls,
+                                detail: index.details[i],
+                                kind: monaco.languages.CompletionItemKind.Value,
+                                range: range
+                            });
+                        }
+                        return { suggestions: suggestions, incomplete: suggestions.length === MAX_COMPLETIONS };
+                    }, function () {
+                        return { suggestions: [] };
+                    });
+                }
+            });
+        });
+    }
+
+    function toggleMinimap(editor) {
+        var enabled = editor.getOptions().get(monaco.editor.EditorOption.minimap).enabled;
+        editor.updateOptions({ minimap: { enabled: !enabled } });
+    }
+
+    function toggleLineWrap(editor) {
+        var wordWrap = editor.getOptions().get(monaco.editor.EditorOption.wordWrap);
+        editor.updateOptions({ wordWrap: wordWrap === 'off' ? 'on' : 'off' });
+    }
+
+    var monacoEditor = {
+        init: function (id, vsUrl, options) {
+            var state = instance(id);
+            var started = performance.now();
+            var cached = !!window.monaco;
+            state.language = options.language;
+
+            loadMonaco(vsUrl).then(function () {
+                var element = document.getElementById(id);
+                if (editors[id] !== state || !element) {
+                    return;
+                }
+
+                if (options.completions) {
+                    registerCompletions(options.completions);
+                }
+
+                element.classList.add('flex', 'flex-col');
+                state.tabBar = document.createElement('div');
+                state.tabBar.className = TAB_BAR_CLASSES;
+                state.tabBar.style.display = 'none';
+                var host = document.createElement('div');
+                host.className = 'flex-1 overflow-hidden';
+                host.style.minHeight = '0';
+                element.appendChild(state.tabBar);
+                element.appendChild(host);
+
+                state.editor = monaco.editor.create(host, {
+                    model: null,
+                    theme: (darkTheme !== null ? darkTheme : options.dark) ? 'vs-dark' : 'vs-light',
+                    wordWrap: 'on',
+                    lineNumbers: 'on',
+                    tabSize: 4,
+                    insertSpaces: false,
+                    detectIndentation: false,
+                    trimAutoWhitespace: false,
+                    minimap: { enabled: false },
+                    automaticLayout: true,
+                    scrollbar: {
+                        vertical: 'auto',    // Show vertical scrollbar only if needed
+                        horizontal: 'auto',  // Show horizontal scrollbar only if needed
+                        handleMouseWheel: true
+                    },
+                    scrollBeyondLastLine: false
+                });
+
+                state.editor.onDidBlurEditorText(function () {
+                    if (state.active) {
+                        flush(id, state.active);
+                    }
+                });
+                state.editor.onKeyDown(function (e) {
+                    var key = e.browserEvent;
+                    if ((key.ctrlKey || key.metaKey) && key.key === 's') {
+                        key.preventDefault();
+                        // Reaches the server before the key event that triggers the save
+                        if (state.active) {
+                            flush(id, state.active);
+                        }
+                    }
+                    if (key.altKey && key.key === 'x') {
+                        toggleMinimap(state.editor);
+                    }
+                    if (key.altKey && key.key === 'z') {
+                        key.preventDefault();
+                        toggleLineWrap(state.editor);
+                    }
+                });
+
+                state.resolve();
+                Wt.emit(id, 'editorReady', Math.round(performance.now() - started), cached);
+            });
+        },
+
+        destroy: function (id) {
+            var state = editors[id];
+            if (!state) {
+                return;
+            }
+            delete editors[id];
+            if (state.editor) {
+                for (var generation in state.documents) {
+                    dropDocument(state, state.documents[generation]);
+                }
+                state.editor.dispose();
+            }
+        },
+
+        /*
+         * Opens a file the server loaded under the given generation in a new tab.
+         * A tab still showing the same path is replaced.
+         */
+        open: function (id, url, generation, path, large) {
+            withEditor(id, function (editor, state) {
+                for (var key in state.documents) {
+                    if (state.documents[key].path === path) {
+                        dropDocument(state, state.documents[key]);
+                    }
+                }
+
+                var doc = {
+                    generation: generation,
+                    path: path,
+                    large: large,
+                    loading: true,
+                    seq: 0,
+                    pending: [],
+                    timers: {},
+                    model: monaco.editor.createModel('', languageOf(state, path))
+                };
+                doc.model.setEOL(monaco.editor.EndOfLineSequence.LF);
+                doc.model.onDidChangeContent(function (event) {
+                    onContentChanged(id, state, doc, event);
+                });
+                state.documents[generation] = doc;
+                activate(id, state, doc);
+
+                fetch(url).then(function (response) {
+                    if (doc.closed) {
+                        return;
+                    }
+                    if (large) {
+                        return streamText(id, state, doc, response);
+                    }
+                    return response.text().then(function (text) {
+                        if (!doc.closed) {
+                            doc.model.setValue(text);
+                            doc.loading = false;
+                            if (state.active === doc) {
+                                editor.updateOptions({ readOnly: state.readOnly });
+                            }
+                        }
+                    });
+                });
+            });
+        },
+
+        activate: function (id, generation) {
+            withEditor(id, function (editor, state) {
+                if (state.documents[generation]) {
+                    activate(id, state, state.documents[generation]);
+                }
+            });
+        },
+
+        close: function (id, generation) {
+            withEditor(id, function (editor, state) {
+                if (state.documents[generation]) {
+                    closeDocument(id, state, state.documents[generation]);
+                }
+            });
+        },
+
+        resync: function (id, generation) {
+            withEditor(id, function (editor, state) {
+                var doc = state.documents[generation];
+                if (!doc) {
+                    return;
+                }
+                clearTimeout(doc.timers.idle);
+                clearTimeout(doc.timers.latency);
+                doc.timers.latency = null;
+                doc.pending = [];
+                Wt.emit(id, 'editorResync', doc.generation, doc.seq, doc.model.getValue());
+            });
+        },
+
+        /*
+         * Shows the diagnostics of the server's XmlValidator. Each marker is
+         * [line, column, endLine, endColumn, error, message], an endColumn of 0
+         * marks the whole line.
+         */
+        setMarkers: function (id, generation, markers) {
+            withEditor(id, function (editor, state) {
+                var doc = state.documents[generation];
+                if (!doc) {
+                    return;
+                }
+                var model = doc.model;
+                monaco.editor.setModelMarkers(model, 'stylus-xml', markers.map(function (m) {
+                    var line = Math.min(m[0], model.getLineCount());
+                    var endLine = Math.min(m[2], model.getLineCount());
+                    return {
+                        startLineNumber: line,
+                        startColumn: m[1],
+                        endLineNumber: endLine,
+                        endColumn: m[3] || model.getLineMaxColumn(endLine),
+                        severity: m[4] ? monaco.MarkerSeverity.Error : monaco.MarkerSeverity.Warning,
+                        message: m[5]
+                    };
+                }));
+            });
+        },
+
+        setSyncWindow: function (id, idleMs, maxLatencyMs) {
+            var state = instance(id);
+            state.idleMs = idleMs;
+            state.maxLatencyMs = maxLatencyMs;
+        },
+
+        setReadOnly: function (id, readOnly) {
+            withEditor(id, function (editor, state) {
+                state.readOnly = readOnly;
+                editor.updateOptions({ readOnly: readOnly || (state.active !== null && state.active.loading) });
+            });
+        },
+
+        layout: function (id) {
+            withEditor(id, function (editor) { editor.layout(); });
+        },
+
+        toggleLineWrap: function (id) {
+            withEditor(id, toggleLineWrap);
+        },
+
+        toggleMinimap: function (id) {
+            withEditor(id, toggleMinimap);
+        },
+
+        setDarkTheme: function (dark) {
+            darkTheme = dark;
+            if (monacoLoaded) {
+                monacoLoaded.then(function () { monaco.editor.setTheme(dark ? 'vs-dark' : 'vs-light'); });
+            }
+        }
+    };
+
+    window.StylusComponents = {
+        dragBar: dragBar,
+        monacoEditor: monacoEditor
+    };
+})();
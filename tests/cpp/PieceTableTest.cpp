@@ -0,0 +1,111 @@
+/*
+ * Tests of PieceTable, run by ctest (see CMakeLists.txt).
+ *
+ * The ranges given to replace() come from the browser, so besides random edits
+ * checked against a plain string, ranges outside the text must be refused
+ * without touching it.
+ */
+
+#include "005_Components/PieceTable.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what)
+{
+    if (!condition) {
+        std::cerr << "FAILED: " << what << "\n";
+        ++failures;
+    }
+}
+
+void checkRefused(PieceTable& table, std::size_t offset, std::size_t length, const std::string& what)
+{
+    const std::string before = table.text();
+    const std::size_t units = table.units();
+    check(!table.replace(offset, length, "Z"), what + " is refused");
+    check(table.text() == before && table.units() == units && table.size() == before.size(), what + " leaves the text alone");
+}
+
+void invalidRanges()
+{
+    const std::size_t huge = std::numeric_limits<std::size_t>::max();
+
+    PieceTable table;
+    table.reset(std::string("hello world"));
+    checkRefused(table, 5, static_cast<std::size_t>(-3), "a length wrapping around");
+    checkRefused(table, 12, 0, "an offset past the end");
+    checkRefused(table, 11, 1, "a range past the end");
+    checkRefused(table, 6, 6, "a range ending one past the end");
+    checkRefused(table, huge, 2, "an offset of SIZE_MAX");
+    checkRefused(table, 2, huge, "a length of SIZE_MAX");
+    checkRefused(table, huge, huge, "both SIZE_MAX");
+
+    // The edges themselves are fine
+    check(table.replace(11, 0, "!"), "appending at the end");
+    check(table.replace(0, 0, ">"), "inserting at the start");
+    check(table.replace(0, table.units(), "all"), "replacing everything");
+    check(table.text() == "all", "replacing everything gives the new text");
+
+    // Lengths are UTF-16 code units, an emoji counts twice
+    table.reset(std::string("a\xF0\x9F\x98\x80" "b"));
+    check(table.units() == 4, "units of a surrogate pair");
+    checkRefused(table, 0, 5, "a range past the end of non-ASCII text");
+    check(table.replace(1, 2, ""), "removing the surrogate pair");
+    check(table.text() == "ab" && table.units() == 2, "text after removing the surrogate pair");
+
+    PieceTable empty;
+    checkRefused(empty, 0, 1, "removing from an empty text");
+    checkRefused(empty, 1, 0, "inserting past an empty text");
+    check(empty.replace(0, 0, "x") && empty.text() == "x", "inserting into an empty text");
+}
+
+void randomEdits()
+{
+    std::mt19937 random(42);
+    std::string expected = "The quick brown fox jumps over the lazy dog";
+    PieceTable table;
+    table.reset(expected);
+
+    for (int i = 0; i < 20000; ++i) {
+        const std::size_t offset = random() % (expected.size() + 1);
+        const std::size_t length = random() % (expected.size() - offset + 1) % 8;
+        const std::string text(random() % 4, static_cast<char>('a' + random() % 26));
+        check(table.replace(offset, length, text), "a valid random edit");
+        expected.replace(offset, length, text);
+
+        // The cached checksum follows every edit
+        if (i % 1000 == 0) {
+            check(table.checksum() == PieceTable::checksum(expected), "cached checksum after an edit");
+        }
+
+        // An invalid range in between changes nothing
+        if (i % 100 == 0) {
+            checkRefused(table, expected.size() + 1 + random() % 10, random() % 3, "a random offset past the end");
+        }
+    }
+    check(table.text() == expected, "random edits give the same text as std::string");
+    check(table.units() == expected.size(), "units after random edits");
+    check(table.checksum() == PieceTable::checksum(expected), "checksum after random edits");
+}
+
+}
+
+int main()
+{
+    invalidRanges();
+    randomEdits();
+    if (failures > 0) {
+        std::cerr << failures << " checks failed\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "ok\n";
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,197 @@
+/*
+ * Scripts typing sessions against the change coalescing of
+ * StylusComponents.monacoEditor (static/js/components.js) and counts the
+ * editorDelta events that reach the server. Monaco, the DOM, Wt.emit() and the
+ * timers are replaced by fakes driven by a virtual clock.
+ *
+ *   node tests/js/monaco-coalescing.test.js
+ */
+'use strict';
+
+const assert = require('assert');
+const fs = require('fs');
+const path = require('path');
+const vm = require('vm');
+
+const SOURCE = path.join(__dirname, '..', '..', 'static', 'js', 'components.js');
+
+// setTimeout() and friends on a virtual clock, advanced by the test
+function createClock() {
+    let now = 0;
+    let nextId = 1;
+    const timers = new Map();
+    return {
+        setTimeout(f, ms) {
+            const id = nextId++;
+            timers.set(id, { at: now + (ms || 0), id, f });
+            return id;
+        },
+        clearTimeout(id) {
+            timers.delete(id);
+        },
+        // Runs every timer due until time, in order of their due time
+        advanceTo(time) {
+            for (;;) {
+                let next = null;
+                for (const timer of timers.values()) {
+                    if (timer.at <= time && (!next || timer.at < next.at || (timer.at === next.at && timer.id < next.id))) {
+                        next = timer;
+                    }
+                }
+                if (!next) {
+                    break;
+                }
+                timers.delete(next.id);
+                now = next.at;
+                next.f();
+            }
+            now = time;
+        },
+        get now() {
+            return now;
+        }
+    };
+}
+
+function createElement() {
+    return {
+        style: {},
+        classList: { add() {} },
+        appendChild() {},
+        addEventListener() {},
+        set textContent(value) {},
+        get textContent() { return ''; }
+    };
+}
+
+function createModel() {
+    const listeners = [];
+    let value = '';
+    return {
+        setEOL() {},
+        dispose() {},
+        getValue() { return value; },
+        setValue(text) {
+            value = text;
+            listeners.forEach((f) => f({ isFlush: true, changes: [] }));
+        },
+        onDidChangeContent(f) { listeners.push(f); },
+        // What Monaco reports for a single edit
+        edit(offset, length, text) {
+            value = value.substring(0, offset) + text + value.substring(offset + length);
+            listeners.forEach((f) => f({ isFlush: false, changes: [{ rangeOffset: offset, rangeLength: length, text }] }));
+        }
+    };
+}
+
+function load() {
+    const clock = createClock();
+    const events = [];
+    const models = [];
+    const context = {
+        console,
+        Promise,
+        TextEncoder,
+        performance: { now: () => clock.now },
+        setTimeout: clock.setTimeout,
+        clearTimeout: clock.clearTimeout,
+        document: {
+            getElementById: createElement,
+            createElement
+        },
+        Wt: { emit: (id, name, ...args) => events.push({ at: clock.now, name, args }) },
+        require: Object.assign((modules, resolve) => resolve(), { config() {} }),
+        fetch: () => Promise.resolve({ text: () => Promise.resolve('') }),
+        monaco: {
+            editor: {
+                EndOfLineSequence: { LF: 0 },
+                create: () => ({
+                    onDidBlurEditorText() {},
+                    onKeyDown() {},
+                    updateOptions() {},
+                    setModel() {},
+                    focus() {},
+                    saveViewState() {},
+                    restoreViewState() {},
+                    dispose() {}
+                }),
+                createModel: () => {
+                    const model = createModel();
+                    models.push(model);
+                    return model;
+                },
+                setModelMarkers() {}
+            }
+        }
+    };
+    context.window = context;
+    vm.runInNewContext(fs.readFileSync(SOURCE, 'utf8'), context, { filename: SOURCE });
+    return { clock, events, models, editor: context.StylusComponents.monacoEditor };
+}
+
+function settle() {
+    return new Promise((resolve) => setImmediate(resolve));
+}
+
+// Opens an empty document and types the script, one character per keystroke at the given times
+async function type(keystrokes) {
+    const { clock, events, models, editor } = load();
+    editor.init('e', '/vendor/monaco', { language: 'xml' });
+    await settle();
+    editor.open('e', '/file', 1, 'page.xml', false);
+    await settle();
+    await settle();
+    const model = models[0];
+    assert.ok(model, 'the document was not opened');
+
+    let text = '';
+    for (const at of keystrokes) {
+        clock.advanceTo(at);
+        model.edit(text.length, 0, 'a');
+        text += 'a';
+    }
+    clock.advanceTo(keystrokes[keystrokes.length - 1] + 10000);
+
+    const deltas = events.filter((e) => e.name === 'editorDelta');
+    // The server applies the deltas in order and must end up with the same text
+    let replayed = '';
+    deltas.forEach((delta, i) => {
+        assert.strictEqual(delta.args[1], i + 1, 'deltas are not numbered in order');
+        for (const [offset, length, inserted] of JSON.parse(delta.args[2])) {
+            replayed = replayed.substring(0, offset) + inserted + replayed.substring(offset + length);
+        }
+    });
+    assert.strictEqual(replayed, model.getValue(), 'the deltas do not reproduce the text');
+    return { deltas: deltas.length, checksums: events.filter((e) => e.name === 'editorChecksum').length };
+}
+
+// count keystrokes every interval ms, starting at start
+function burst(start, count, interval) {
+    return Array.from({ length: count }, (_, i) => start + i * interval);
+}
+
+async function main() {
+    // 25 words of 8 characters typed 100 ms apart, with a second of thinking between
+    // words: each word fits the idle window and goes out as one delta
+    let keystrokes = [];
+    for (let word = 0; word < 25; ++word) {
+        keystrokes = keystrokes.concat(burst(word * 1800, 8, 100));
+    }
+    let result = await type(keystrokes);
+    console.log(`bursts: ${keystrokes.length} keystrokes -> ${result.deltas} deltas, ${result.checksums} checksums`);
+    assert.strictEqual(result.deltas, 25);
+
+    // 10 seconds of typing without a pause: the latency cap sends about one delta a second
+    keystrokes = burst(0, 100, 101);
+    result = await type(keystrokes);
+    console.log(`continuous: ${keystrokes.length} keystrokes -> ${result.deltas} deltas, ${result.checksums} checksums`);
+    assert.ok(result.deltas <= 11, `${result.deltas} deltas for 10 seconds of typing`);
+    assert.strictEqual(result.checksums, 1);
+
+    console.log('ok');
+}
+
+main().catch((error) => {
+    console.error(error);
+    process.exit(1);
+});
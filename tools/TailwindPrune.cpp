@@ -0,0 +1,203 @@
+/*
+ * tailwind-prune
+ *
+ * Scans the XML templates and C++ sources for every token that may be used as a
+ * class, then drops the rules of the compiled Tailwind stylesheet that reference
+ * a class nobody uses. Writes the pruned stylesheet and a report of what was
+ * removed.
+ *
+ *   tailwind-prune --css static/css/tailwind.minify.css
+ *                  --out static/css/tailwind.pruned.css
+ *                  --report build/tailwind-prune-report.txt
+ *                  --sources static/0_stylus/xml src
+ *
+ * With --chunk-dir the pruned rules are additionally split into route chunks.
+ * The first --chunk is the core chunk and gets every rule its sources use plus
+ * the non-style rules (@property, ...). Every later chunk gets only the rules its
+ * own sources add on top of the core chunk:
+ *
+ *   tailwind-prune ... --chunk-dir static/css/chunks
+ *                  --chunk core=src/008_ApplicationShell,static/0_stylus/xml/000_General
+ *                  --chunk auth=src/003_Auth,static/0_stylus/xml/001_Auth
+ *
+ * --project <dir> stands for the sources and chunks of this project, the ones
+ * TailwindBuilder uses after each build (see Css::projectPruneSpec()).
+ */
+
+#include "004_Theme/CssPrune.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+struct Options {
+    std::string cssPath;
+    std::string outPath;
+    std::string reportPath;
+    std::string chunkDir;
+    std::vector<std::string> sources;
+    std::vector<Css::Chunk> chunks;
+};
+
+void printUsage()
+{
+    std::cerr << "Usage: tailwind-prune --css <input.css> --out <pruned.css> "
+                 "[--report <report.txt>] (--project <dir> --chunk-dir <dir> | --sources <file-or-dir>... "
+                 "[--chunk-dir <dir> --chunk <name>=<file-or-dir>[,...]...])\n";
+}
+
+bool parseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--css" && i + 1 < argc) {
+            options.cssPath = argv[++i];
+        } else if (arg == "--out" && i + 1 < argc) {
+            options.outPath = argv[++i];
+        } else if (arg == "--report" && i + 1 < argc) {
+            options.reportPath = argv[++i];
+        } else if (arg == "--chunk-dir" && i + 1 < argc) {
+            options.chunkDir = argv[++i];
+        } else if (arg == "--chunk" && i + 1 < argc) {
+            const std::string spec = argv[++i];
+            const std::size_t eq = spec.find('=');
+            if (eq == std::string::npos || eq == 0) {
+                return false;
+            }
+            Css::Chunk chunk;
+            chunk.name = spec.substr(0, eq);
+            std::stringstream paths(spec.substr(eq + 1));
+            std::string path;
+            while (std::getline(paths, path, ',')) {
+                if (!path.empty()) {
+                    chunk.sources.push_back(path);
+                }
+            }
+            options.chunks.push_back(std::move(chunk));
+        } else if (arg == "--project" && i + 1 < argc) {
+            Css::PruneSpec spec = Css::projectPruneSpec(argv[++i]);
+            options.sources = std::move(spec.sources);
+            options.chunks = std::move(spec.chunks);
+        } else if (arg == "--sources") {
+            while (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0) {
+                options.sources.push_back(argv[++i]);
+            }
+        } else {
+            return false;
+        }
+    }
+    if (options.chunkDir.empty() != options.chunks.empty()) {
+        return false;
+    }
+    return !options.cssPath.empty() && !options.outPath.empty() && !options.sources.empty();
+}
+
+bool readFile(const fs::path& path, std::string& content)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::ostringstream stream;
+    stream << file.rdbuf();
+    content = stream.str();
+    return true;
+}
+
+bool writeFile(const fs::path& path, const std::string& content)
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "error: cannot write " << path << "\n";
+        return false;
+    }
+    out << content;
+    return true;
+}
+
+// Splits the stylesheet into one file per chunk, see the header comment
+bool writeChunks(const Options& options, const std::vector<Css::Rule>& rules)
+{
+    fs::create_directories(options.chunkDir);
+
+    const std::vector<std::string> sheets = Css::splitChunks(rules, options.chunks);
+    for (std::size_t i = 0; i < options.chunks.size(); ++i) {
+        if (!writeFile(fs::path(options.chunkDir) / (options.chunks[i].name + ".css"), sheets[i])) {
+            return false;
+        }
+        std::cout << "chunk " << options.chunks[i].name << ": " << sheets[i].size() << " bytes\n";
+    }
+    return true;
+}
+
+bool writeReport(const std::string& path, const Css::PruneReport& report,
+                 std::size_t inputBytes, std::size_t outputBytes)
+{
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    file << "input-bytes " << inputBytes << "\n"
+         << "output-bytes " << outputBytes << "\n"
+         << "source-files " << report.sourceFiles << "\n"
+         << "class-candidates " << report.candidates << "\n"
+         << "removed-selectors " << report.removedSelectors.size() << "\n"
+         << "removed-keyframes " << report.removedKeyframes.size() << "\n\n";
+
+    for (const std::string& selector : report.removedSelectors) {
+        file << "selector " << selector << "\n";
+    }
+    for (const std::string& name : report.removedKeyframes) {
+        file << "keyframes " << name << "\n";
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    std::string css;
+    if (!readFile(options.cssPath, css)) {
+        std::cerr << "error: cannot read " << options.cssPath << "\n";
+        return 1;
+    }
+
+    Css::PruneReport report;
+    const std::vector<Css::Rule> rules = Css::prune(Css::parse(css), options.sources, report);
+    for (const std::string& source : report.missingSources) {
+        std::cerr << "warning: cannot read source " << source << "\n";
+    }
+
+    const std::string pruned = Css::serialize(rules);
+    if (!writeFile(options.outPath, pruned)) {
+        return 1;
+    }
+
+    if (!options.reportPath.empty() && !writeReport(options.reportPath, report, css.size(), pruned.size())) {
+        std::cerr << "error: cannot write " << options.reportPath << "\n";
+        return 1;
+    }
+
+    std::cout << options.cssPath << ": " << css.size() << " -> " << pruned.size() << " bytes, "
+              << report.removedSelectors.size() << " selectors removed\n";
+
+    if (!options.chunks.empty() && !writeChunks(options, rules)) {
+        return 1;
+    }
+    return 0;
+}